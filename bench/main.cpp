@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <anns_dataset.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+struct config_t {
+  std::string work_dir = ".";
+  std::size_t dataset_bytes = 256lu << 20;
+  std::size_t num_repeats = 3;
+  std::vector<std::size_t> dims = {96, 128, 960};
+  std::vector<unsigned> num_threads = {1, 4, 16};
+  std::vector<std::string> dtypes = {"float", "uint8", "int8"};
+  bool drop_cache = false;
+  bool json = false;
+};
+
+struct result_t {
+  std::string op;
+  std::string file_dtype;
+  std::string mem_dtype;
+  std::string format;
+  std::size_t dim;
+  std::size_t num_rows;
+  unsigned num_threads;
+  std::string cache;
+  std::size_t bytes;
+  double median_time;
+  double best_time;
+};
+
+std::vector<result_t> result_list;
+
+// Evict the file from the page cache so that the next read hits the device
+void drop_page_cache(const std::string path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// Median and best of `num_repeats` runs of `func` in seconds
+std::pair<double, double> measure(const std::size_t num_repeats,
+                                  const std::function<void()> prepare,
+                                  const std::function<int()> func) {
+  std::vector<double> times;
+  for (std::size_t r = 0; r < num_repeats; r++) {
+    prepare();
+    const auto start_clock = std::chrono::steady_clock::now();
+    if (func()) {
+      throw std::runtime_error("Benchmark target failed");
+    }
+    const auto end_clock = std::chrono::steady_clock::now();
+    times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        end_clock - start_clock)
+                        .count() *
+                    1e-9);
+  }
+  std::sort(times.begin(), times.end());
+  return {times[times.size() / 2], times[0]};
+}
+
+void record(const config_t &config, result_t result,
+            const std::function<void()> prepare,
+            const std::function<int()> func) {
+  const auto [median_time, best_time] =
+      measure(config.num_repeats, prepare, func);
+  result.median_time = median_time;
+  result.best_time = best_time;
+  std::fprintf(stderr,
+               "%-20s %-8s -> %-8s %-12s dim=%4zu threads=%2u %-5s : %8.3f "
+               "GB/s, %.3e rows/s\n",
+               result.op.c_str(), result.file_dtype.c_str(),
+               result.mem_dtype.c_str(), result.format.c_str(), result.dim,
+               result.num_threads, result.cache.c_str(),
+               result.bytes / median_time * 1e-9,
+               result.num_rows / median_time);
+  result_list.push_back(result);
+}
+
+template <class T> std::string get_dtype_str() {
+  return mtk::anns_dataset::get_type_str<T>();
+}
+
+template <class T> std::vector<T> make_dataset(const std::size_t num_elements) {
+  std::mt19937 mt(num_elements);
+  std::vector<T> dataset(num_elements);
+  if constexpr (std::is_integral<T>::value) {
+    std::uniform_int_distribution<int> dist(std::numeric_limits<T>::min(),
+                                            std::numeric_limits<T>::max());
+    for (auto &v : dataset) {
+      v = dist(mt);
+    }
+  } else {
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (auto &v : dataset) {
+      v = static_cast<T>(dist(mt));
+    }
+  }
+  return dataset;
+}
+
+// Load benchmarks of a file of T into an array of MEM_T
+template <class MEM_T, class T>
+void bench_load(const config_t &config, const std::string path,
+                const mtk::anns_dataset::format_t format, const std::size_t dim,
+                const std::size_t num_rows) {
+  std::vector<MEM_T> dst(num_rows * dim);
+  const auto row_bytes = dim * sizeof(T);
+  const mtk::anns_dataset::range_t range{.offset = num_rows / 4,
+                                         .size = num_rows / 2};
+
+  for (const std::string cache : {"warm", "cold"}) {
+    if (cache == "cold" && !config.drop_cache) {
+      continue;
+    }
+    const std::function<void()> prepare = [&]() {
+      if (cache == "cold") {
+        drop_page_cache(path);
+      } else {
+        // Warm the page cache
+        mtk::anns_dataset::load_parallel<MEM_T, T>(dst.data(), path, 0, false,
+                                                   format);
+      }
+    };
+    const result_t base{"",
+                        get_dtype_str<T>(),
+                        get_dtype_str<MEM_T>(),
+                        mtk::anns_dataset::get_format_str(format),
+                        dim,
+                        num_rows,
+                        1,
+                        cache,
+                        num_rows * row_bytes,
+                        0,
+                        0};
+
+    auto result = base;
+    result.op = "load";
+    record(config, result, prepare, [&]() {
+      return mtk::anns_dataset::load<MEM_T, T>(dst.data(), path, false,
+                                               format);
+    });
+
+    for (const auto num_threads : config.num_threads) {
+      result = base;
+      result.op = "load_parallel";
+      result.num_threads = num_threads;
+      record(config, result, prepare, [&]() {
+        return mtk::anns_dataset::load_parallel<MEM_T, T>(
+            dst.data(), path, num_threads, false, format);
+      });
+
+      result.op = "load_parallel_range";
+      result.num_rows = range.size;
+      result.bytes = range.size * row_bytes;
+      record(config, result, prepare, [&]() {
+        return mtk::anns_dataset::load_parallel<MEM_T, T>(
+            dst.data(), path, num_threads, false, format, range);
+      });
+    }
+  }
+}
+
+template <class T>
+void bench_core(const config_t &config, const std::size_t dim,
+                const mtk::anns_dataset::format_t format) {
+  const auto num_rows =
+      std::max<std::size_t>(1, config.dataset_bytes / (dim * sizeof(T)));
+  const auto dataset = make_dataset<T>(num_rows * dim);
+  const auto path = config.work_dir + "/anns-ds.bench." + get_dtype_str<T>() +
+                    "." + std::to_string(dim) + ".dat";
+
+  const result_t base{"",
+                      get_dtype_str<T>(),
+                      get_dtype_str<T>(),
+                      mtk::anns_dataset::get_format_str(format),
+                      dim,
+                      num_rows,
+                      1,
+                      "-",
+                      num_rows * dim * sizeof(T),
+                      0,
+                      0};
+  const std::function<void()> no_prepare = []() {};
+
+  // Store into the page cache
+  auto result = base;
+  result.op = "store";
+  record(config, result, no_prepare, [&]() {
+    return mtk::anns_dataset::store(path, num_rows, dim, dataset.data(),
+                                    format);
+  });
+
+  result.op = "store_stream_append";
+  record(config, result, no_prepare, [&]() {
+    const std::size_t batch_size = 4096;
+    mtk::anns_dataset::store_stream<T> ss(path, dim, format);
+    for (std::size_t i = 0; i < num_rows; i += batch_size) {
+      ss.append(dataset.data() + i * dim, dim,
+                std::min(batch_size, num_rows - i));
+    }
+    ss.close();
+    return 0;
+  });
+
+  bench_load<T, T>(config, path, format, dim, num_rows);
+  if constexpr (!std::is_same<T, float>::value) {
+    // MEM_T != T
+    bench_load<float, T>(config, path, format, dim, num_rows);
+  }
+  std::remove(path.c_str());
+}
+
+template <class T> void bench(const config_t &config) {
+  using mtk::anns_dataset::format_t;
+  for (const auto dim : config.dims) {
+    for (const auto format :
+         {format_t::FORMAT_BIGANN | format_t::HEADER_U32,
+          format_t::FORMAT_BIGANN | format_t::HEADER_U64,
+          format_t::FORMAT_VECS | format_t::HEADER_U32,
+          format_t::FORMAT_VECS | format_t::HEADER_U64}) {
+      bench_core<T>(config, dim, format);
+    }
+  }
+}
+
+void print_results(const config_t &config) {
+  if (config.json) {
+    std::printf("[\n");
+    for (std::size_t i = 0; i < result_list.size(); i++) {
+      const auto &r = result_list[i];
+      std::printf(
+          "  {\"op\": \"%s\", \"file_dtype\": \"%s\", \"mem_dtype\": \"%s\", "
+          "\"format\": \"%s\", \"dim\": %zu, \"num_rows\": %zu, "
+          "\"num_threads\": %u, \"cache\": \"%s\", \"bytes\": %zu, "
+          "\"median_time\": %e, \"best_time\": %e, \"gbps\": %e, "
+          "\"rows_per_sec\": %e}%s\n",
+          r.op.c_str(), r.file_dtype.c_str(), r.mem_dtype.c_str(),
+          r.format.c_str(), r.dim, r.num_rows, r.num_threads, r.cache.c_str(),
+          r.bytes, r.median_time, r.best_time, r.bytes / r.median_time * 1e-9,
+          r.num_rows / r.median_time, i + 1 < result_list.size() ? "," : "");
+    }
+    std::printf("]\n");
+    return;
+  }
+  std::printf("op,file_dtype,mem_dtype,format,dim,num_rows,num_threads,cache,"
+              "bytes,median_time,best_time,gbps,rows_per_sec\n");
+  for (const auto &r : result_list) {
+    std::printf("%s,%s,%s,%s,%zu,%zu,%u,%s,%zu,%e,%e,%e,%e\n", r.op.c_str(),
+                r.file_dtype.c_str(), r.mem_dtype.c_str(), r.format.c_str(),
+                r.dim, r.num_rows, r.num_threads, r.cache.c_str(), r.bytes,
+                r.median_time, r.best_time, r.bytes / r.median_time * 1e-9,
+                r.num_rows / r.median_time);
+  }
+}
+
+template <class T>
+std::vector<T> parse_list(const std::string str) {
+  std::vector<T> list;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if constexpr (std::is_same<T, std::string>::value) {
+      list.push_back(item);
+    } else {
+      list.push_back(std::stoul(item));
+    }
+  }
+  return list;
+}
+} // unnamed namespace
+
+int main(int argc, char **argv) {
+  config_t config;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const auto get_value = [&](const std::string opt) {
+      return arg.substr(opt.size());
+    };
+    if (arg.rfind("--dir=", 0) == 0) {
+      config.work_dir = get_value("--dir=");
+    } else if (arg.rfind("--size=", 0) == 0) {
+      config.dataset_bytes = std::stoul(get_value("--size=")) << 20;
+    } else if (arg.rfind("--repeat=", 0) == 0) {
+      config.num_repeats = std::max(1lu, std::stoul(get_value("--repeat=")));
+    } else if (arg.rfind("--dims=", 0) == 0) {
+      config.dims = parse_list<std::size_t>(get_value("--dims="));
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      config.num_threads = parse_list<unsigned>(get_value("--threads="));
+    } else if (arg.rfind("--dtypes=", 0) == 0) {
+      config.dtypes = parse_list<std::string>(get_value("--dtypes="));
+    } else if (arg == "--drop-cache") {
+      config.drop_cache = true;
+    } else if (arg == "--json") {
+      config.json = true;
+    } else {
+      std::fprintf(
+          stderr,
+          "Usage: %s [--dir=PATH] [--size=MiB] [--repeat=N] [--dims=96,128] "
+          "[--threads=1,4] [--dtypes=float,uint8,int8,float16] "
+          "[--drop-cache] [--json]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
+  for (const auto &dtype : config.dtypes) {
+    if (dtype == "float") {
+      bench<float>(config);
+    } else if (dtype == "uint8") {
+      bench<std::uint8_t>(config);
+    } else if (dtype == "int8") {
+      bench<std::int8_t>(config);
+    } else if (dtype == "float16") {
+      bench<mtk::anns_dataset::float16_t>(config);
+    } else {
+      std::fprintf(stderr, "Invalid data type %s\n", dtype.c_str());
+      return 1;
+    }
+  }
+  print_results(config);
+  return 0;
+}
@@ -1,9 +1,35 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
 
 namespace mtk {
 namespace anns_dataset {
@@ -86,7 +112,537 @@ bool is_vecs(const HEADER_T header[2], const std::size_t file_size) {
 struct range_t {
   std::size_t offset;
   std::size_t size;
+
+  // The range lies in a dataset of `num_data` vectors
+  inline bool is_valid(const std::size_t num_data) const {
+    return offset <= num_data && size <= num_data - offset;
+  }
+  // The number of vectors in the range. size == 0 means up to the end
+  inline std::size_t get_size(const std::size_t num_data) const {
+    return size == 0 ? num_data - offset : size;
+  }
+};
+
+// Subset of dimensions to be loaded
+struct projection_t {
+  // Contiguous window [offset, offset + size). size == 0 means all dimensions
+  std::size_t offset = 0;
+  std::size_t size = 0;
+  // Dimension index list. Used instead of the window when not empty
+  std::vector<std::size_t> indices;
+
+  static inline projection_t window(const std::size_t offset,
+                                    const std::size_t size) {
+    projection_t p;
+    p.offset = offset;
+    p.size = size;
+    return p;
+  }
+  static inline projection_t list(const std::vector<std::size_t> &indices) {
+    projection_t p;
+    p.indices = indices;
+    return p;
+  }
+
+  inline bool is_full(const std::size_t data_dim) const {
+    return indices.empty() && offset == 0 && (size == 0 || size == data_dim);
+  }
+  // The number of loaded dimensions
+  inline std::size_t get_dim(const std::size_t data_dim) const {
+    if (!indices.empty()) {
+      return indices.size();
+    }
+    return size == 0 ? data_dim - offset : size;
+  }
+  // The smallest window [first, second) that covers the loaded dimensions
+  inline std::pair<std::size_t, std::size_t>
+  get_span(const std::size_t data_dim) const {
+    if (!indices.empty()) {
+      const auto [min, max] =
+          std::minmax_element(indices.begin(), indices.end());
+      return std::make_pair(*min, *max + 1);
+    }
+    return std::make_pair(offset, offset + get_dim(data_dim));
+  }
+};
+
+// Counters of a load or store
+struct io_metrics_t {
+  std::size_t bytes_read = 0;
+  std::size_t bytes_written = 0;
+  std::size_t num_read_calls = 0;
+  std::size_t num_write_calls = 0;
+  // The number of vectors processed so far and in total (0: unknown)
+  std::size_t num_done = 0;
+  std::size_t num_total = 0;
+  // Seconds spent in read/write calls and in the element conversion, summed
+  // over all threads
+  double io_time = 0;
+  double convert_time = 0;
+  // Wall-clock seconds since the start
+  double elapsed_time = 0;
+
+  // Bytes per second
+  inline double get_throughput() const {
+    return elapsed_time > 0 ? (bytes_read + bytes_written) / elapsed_time : 0;
+  }
+};
+
+// Receives the metrics of a load or store. `on_progress` is called after a
+// block has been processed, at most once per `progress_interval`.
+// Define ANNS_DATASET_DISABLE_OBSERVER to remove all observer calls.
+class io_observer {
+public:
+  std::chrono::nanoseconds progress_interval = std::chrono::milliseconds(100);
+
+  virtual ~io_observer() = default;
+  virtual void on_progress(const io_metrics_t &) {}
+  virtual void on_complete(const io_metrics_t &) {}
+};
+
+namespace detail {
+#ifdef ANNS_DATASET_DISABLE_OBSERVER
+constexpr bool observer_enabled = false;
+#else
+constexpr bool observer_enabled = true;
+#endif
+
+// Progress output of `print_log`
+class log_observer : public io_observer {
+  const std::string name;
+  const std::string verb;
+  bool printed = false;
+
+public:
+  inline log_observer(const std::string name, const std::string verb)
+      : name(name), verb(verb) {}
+
+  inline void on_progress(const io_metrics_t &metrics) override {
+    if (metrics.num_total != 0) {
+      std::printf("[ANNS-DS %s]: %s... (%4.2f %%)\r", name.c_str(),
+                  verb.c_str(), metrics.num_done * 100. / metrics.num_total);
+    } else {
+      std::printf("[ANNS-DS %s]: %s... (%zu vectors)\r", name.c_str(),
+                  verb.c_str(), metrics.num_done);
+    }
+    std::fflush(stdout);
+    printed = true;
+  }
+  inline void on_complete(const io_metrics_t &metrics) override {
+    if (printed) {
+      std::printf("\n");
+    }
+    std::printf("[ANNS-DS %s]: %zu vectors, %.3f GB/s (I/O %.3fs, convert "
+                "%.3fs)\n",
+                name.c_str(), metrics.num_done,
+                metrics.get_throughput() * 1e-9, metrics.io_time,
+                metrics.convert_time);
+    std::fflush(stdout);
+  }
+};
+
+// Accumulates the metrics of one operation from any number of threads and
+// forwards them to the observer. Does nothing without an observer.
+class io_monitor {
+public:
+  using clock_t = std::chrono::steady_clock;
+  using time_point = clock_t::time_point;
+
+private:
+  std::unique_ptr<log_observer> logger;
+  io_observer *observer;
+  std::mutex mtx;
+  io_metrics_t metrics;
+  time_point start_time, last_progress_time;
+
+public:
+  // `print_log` uses a log_observer when no observer is given
+  inline io_monitor(io_observer *const observer, const std::size_t num_total,
+                    const bool print_log = false, const std::string name = "",
+                    const std::string verb = "")
+      : observer(observer) {
+    if (observer == nullptr && print_log) {
+      logger = std::make_unique<log_observer>(name, verb);
+      this->observer = logger.get();
+    }
+    metrics.num_total = num_total;
+    if (enabled()) {
+      start_time = last_progress_time = clock_t::now();
+    }
+  }
+
+  inline bool enabled() const {
+    return observer_enabled && observer != nullptr;
+  }
+
+  static inline time_point now() { return clock_t::now(); }
+  static inline double seconds(const time_point begin, const time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
+  }
+
+  // Add the counters of a processed block
+  inline void add(const io_metrics_t &block) {
+    if (!enabled()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    metrics.bytes_read += block.bytes_read;
+    metrics.bytes_written += block.bytes_written;
+    metrics.num_read_calls += block.num_read_calls;
+    metrics.num_write_calls += block.num_write_calls;
+    metrics.num_done += block.num_done;
+    metrics.io_time += block.io_time;
+    metrics.convert_time += block.convert_time;
+
+    const auto t = clock_t::now();
+    if (t - last_progress_time >= observer->progress_interval) {
+      last_progress_time = t;
+      metrics.elapsed_time = seconds(start_time, t);
+      observer->on_progress(metrics);
+    }
+  }
+
+  // A block of `num_rows` vectors read in [t0, t1) and converted in [t1, now)
+  inline void add_read(const std::size_t bytes, const std::size_t num_rows,
+                       const time_point t0, const time_point t1) {
+    if (!enabled()) {
+      return;
+    }
+    io_metrics_t block;
+    block.bytes_read = bytes;
+    block.num_read_calls = 1;
+    block.num_done = num_rows;
+    block.io_time = seconds(t0, t1);
+    block.convert_time = seconds(t1, now());
+    add(block);
+  }
+
+  // The current time when enabled
+  inline time_point get_time() const {
+    return enabled() ? now() : time_point{};
+  }
+
+  inline void complete() {
+    if (!enabled()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    metrics.elapsed_time = seconds(start_time, clock_t::now());
+    observer->on_complete(metrics);
+  }
+};
+} // namespace detail
+
+namespace detail {
+inline float fp32_from_bits(const std::uint32_t v) {
+  float f;
+  std::memcpy(&f, &v, sizeof(f));
+  return f;
+}
+inline std::uint32_t fp32_to_bits(const float f) {
+  std::uint32_t v;
+  std::memcpy(&v, &f, sizeof(v));
+  return v;
+}
+
+// IEEE binary16 <-> binary32 conversion (round to nearest even)
+inline std::uint16_t fp32_to_fp16_bits(const float f) {
+  const std::uint32_t w = fp32_to_bits(f);
+  const std::uint32_t shl1_w = w + w;
+  const std::uint32_t sign = w & 0x80000000u;
+  std::uint32_t bias = shl1_w & 0xff000000u;
+  if (bias < 0x71000000u) {
+    bias = 0x71000000u;
+  }
+  float base = (std::abs(f) * 0x1.0p+112f) * 0x1.0p-110f;
+  base = fp32_from_bits((bias >> 1) + 0x07800000u) + base;
+  const std::uint32_t bits = fp32_to_bits(base);
+  const std::uint32_t exp_bits = (bits >> 13) & 0x00007c00u;
+  const std::uint32_t mantissa_bits = bits & 0x00000fffu;
+  const std::uint32_t nonsign = exp_bits + mantissa_bits;
+  return static_cast<std::uint16_t>((sign >> 16) |
+                                    (shl1_w > 0xff000000u ? 0x7e00u : nonsign));
+}
+inline float fp16_bits_to_fp32(const std::uint16_t h) {
+  const std::uint32_t w = static_cast<std::uint32_t>(h) << 16;
+  const std::uint32_t sign = w & 0x80000000u;
+  const std::uint32_t two_w = w + w;
+  const float normalized =
+      fp32_from_bits((two_w >> 4) + (0xe0u << 23)) * 0x1.0p-112f;
+  const float denormalized =
+      fp32_from_bits((two_w >> 17) | (126u << 23)) - 0.5f;
+  return fp32_from_bits(sign | (two_w < (1u << 27) ? fp32_to_bits(denormalized)
+                                                   : fp32_to_bits(normalized)));
+}
+
+// bfloat16 <-> binary32 conversion (round to nearest even)
+inline std::uint16_t fp32_to_bf16_bits(const float f) {
+  const std::uint32_t w = fp32_to_bits(f);
+  if ((w & 0x7fffffffu) > 0x7f800000u) {
+    // Quiet NaN
+    return static_cast<std::uint16_t>((w >> 16) | 0x40u);
+  }
+  return static_cast<std::uint16_t>((w + 0x7fffu + ((w >> 16) & 1u)) >> 16);
+}
+inline float bf16_bits_to_fp32(const std::uint16_t h) {
+  return fp32_from_bits(static_cast<std::uint32_t>(h) << 16);
+}
+} // namespace detail
+
+// 16-bit floating point storage types
+struct float16_t {
+  std::uint16_t data;
+
+  float16_t() = default;
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  explicit float16_t(const T v)
+      : data(detail::fp32_to_fp16_bits(static_cast<float>(v))) {}
+  inline operator float() const { return detail::fp16_bits_to_fp32(data); }
+};
+
+struct bfloat16_t {
+  std::uint16_t data;
+
+  bfloat16_t() = default;
+  template <class T, class = typename std::enable_if<
+                         std::is_arithmetic<T>::value>::type>
+  explicit bfloat16_t(const T v)
+      : data(detail::fp32_to_bf16_bits(static_cast<float>(v))) {}
+  inline operator float() const { return detail::bf16_bits_to_fp32(data); }
+};
+
+namespace detail {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ANNS_DATASET_X86_SIMD
+inline bool cpu_has_avx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+inline bool cpu_has_f16c() {
+  static const bool supported =
+      __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+  return supported;
+}
+
+// The kernels below process the main part of the arrays and return the
+// number of converted elements. The tail is converted by the caller.
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(float *const dst, const std::uint8_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)));
+  }
+  return i;
+}
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(float *const dst, const std::int8_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v)));
+  }
+  return i;
+}
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(std::int16_t *const dst, const std::int8_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_cvtepi8_epi16(v));
+  }
+  return i;
+}
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(std::int32_t *const dst, const std::int8_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_cvtepi8_epi32(v));
+  }
+  return i;
+}
+__attribute__((target("avx2"))) inline __m256i
+fp32_to_bf16_avx2(const __m256 v) {
+  const auto w = _mm256_castps_si256(v);
+  const auto lsb = _mm256_and_si256(_mm256_srli_epi32(w, 16),
+                                    _mm256_set1_epi32(1));
+  const auto rounded = _mm256_srli_epi32(
+      _mm256_add_epi32(w, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff))),
+      16);
+  const auto nan = _mm256_or_si256(_mm256_srli_epi32(w, 16),
+                                   _mm256_set1_epi32(0x40));
+  const auto is_nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+  return _mm256_blendv_epi8(rounded, nan, is_nan);
+}
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(bfloat16_t *const dst, const float *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const auto a = fp32_to_bf16_avx2(_mm256_loadu_ps(src + i));
+    const auto b = fp32_to_bf16_avx2(_mm256_loadu_ps(src + i + 8));
+    // packus works within 128-bit lanes
+    const auto packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+  }
+  return i;
+}
+__attribute__((target("avx,f16c"))) inline std::size_t
+convert_f16c(float16_t *const dst, const float *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v =
+        _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+  }
+  return i;
+}
+__attribute__((target("avx2"))) inline std::size_t
+convert_avx2(float *const dst, const bfloat16_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(
+                                  _mm256_cvtepu16_epi32(v), 16)));
+  }
+  return i;
+}
+__attribute__((target("avx,f16c"))) inline std::size_t
+convert_f16c(float *const dst, const float16_t *const src,
+             const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(v));
+  }
+  return i;
+}
+inline bool cpu_has_fma() {
+  static const bool supported = __builtin_cpu_supports("fma");
+  return supported;
+}
+__attribute__((target("avx2,fma"))) inline __m256
+load_q8x8_avx2(const std::uint8_t *const src) {
+  const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+}
+__attribute__((target("avx2,fma"))) inline __m256
+load_q8x8_avx2(const std::int8_t *const src) {
+  const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+  return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v));
+}
+template <class Q>
+__attribute__((target("avx2,fma"))) inline std::size_t
+dequantize_avx2(float *const dst, const Q *const src, const float *const scale,
+                const float *const offset, const std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(load_q8x8_avx2(src + i),
+                                              _mm256_loadu_ps(scale + i),
+                                              _mm256_loadu_ps(offset + i)));
+  }
+  return i;
+}
+#endif
+
+template <class DST_T, class SRC_T>
+inline void convert_scalar(DST_T *const dst, const SRC_T *const src,
+                           const std::size_t n, std::size_t i = 0) {
+  for (; i < n; i++) {
+    dst[i] = static_cast<DST_T>(src[i]);
+  }
+}
+
+// Element-wise conversion of `n` elements. Specializations use SIMD kernels
+// when the CPU supports them.
+template <class DST_T, class SRC_T> struct convert_kernel {
+  static inline void run(DST_T *const dst, const SRC_T *const src,
+                         const std::size_t n) {
+    convert_scalar(dst, src, n);
+  }
+};
+
+#ifdef ANNS_DATASET_X86_SIMD
+template <class DST_T, class SRC_T> struct convert_kernel_avx2 {
+  static inline void run(DST_T *const dst, const SRC_T *const src,
+                         const std::size_t n) {
+    std::size_t i = 0;
+    if (cpu_has_avx2()) {
+      i = convert_avx2(dst, src, n);
+    }
+    convert_scalar(dst, src, n, i);
+  }
+};
+template <>
+struct convert_kernel<float, std::uint8_t>
+    : public convert_kernel_avx2<float, std::uint8_t> {};
+template <>
+struct convert_kernel<float, std::int8_t>
+    : public convert_kernel_avx2<float, std::int8_t> {};
+template <>
+struct convert_kernel<std::int16_t, std::int8_t>
+    : public convert_kernel_avx2<std::int16_t, std::int8_t> {};
+template <>
+struct convert_kernel<std::int32_t, std::int8_t>
+    : public convert_kernel_avx2<std::int32_t, std::int8_t> {};
+template <>
+struct convert_kernel<bfloat16_t, float>
+    : public convert_kernel_avx2<bfloat16_t, float> {};
+template <>
+struct convert_kernel<float, bfloat16_t>
+    : public convert_kernel_avx2<float, bfloat16_t> {};
+template <class DST_T, class SRC_T> struct convert_kernel_f16c {
+  static inline void run(DST_T *const dst, const SRC_T *const src,
+                         const std::size_t n) {
+    std::size_t i = 0;
+    if (cpu_has_f16c()) {
+      i = convert_f16c(dst, src, n);
+    }
+    convert_scalar(dst, src, n, i);
+  }
+};
+template <>
+struct convert_kernel<float16_t, float>
+    : public convert_kernel_f16c<float16_t, float> {};
+template <>
+struct convert_kernel<float, float16_t>
+    : public convert_kernel_f16c<float, float16_t> {};
+#endif
+
+template <class DST_T, class SRC_T>
+inline void convert(DST_T *const dst, const SRC_T *const src,
+                    const std::size_t n) {
+  convert_kernel<DST_T, SRC_T>::run(dst, src, n);
+}
+
+// dst[i] = scale[i] * src[i] + offset[i]
+template <class Q> struct dequantize_kernel {
+  static inline void run(float *const dst, const Q *const src,
+                         const float *const scale, const float *const offset,
+                         const std::size_t n) {
+    std::size_t i = 0;
+#ifdef ANNS_DATASET_X86_SIMD
+    if (cpu_has_avx2() && cpu_has_fma()) {
+      i = dequantize_avx2(dst, src, scale, offset, n);
+    }
+#endif
+    for (; i < n; i++) {
+      dst[i] = std::fma(scale[i], static_cast<float>(src[i]), offset[i]);
+    }
+  }
 };
+} // namespace detail
 
 template <class T, class HEADER_T = void>
 inline format_t detect_file_format(std::ifstream &ifs,
@@ -143,130 +699,1069 @@ inline format_t detect_file_format(const std::string file_path,
   if (!ifs) {
     throw std::runtime_error("No such file: " + file_path);
   }
-  detect_file_format<T, HEADER_T>(ifs, print_log);
+  const auto format = detect_file_format<T, HEADER_T>(ifs, print_log);
   ifs.close();
+  return format;
+}
+
+// The smallest leading dimension >= `data_dim` whose row size in bytes is a
+// multiple of `alignment`
+template <class T>
+inline std::size_t get_aligned_ld(const std::size_t data_dim,
+                                  const std::size_t alignment) {
+  const auto row_size = data_dim * sizeof(T);
+  const auto aligned_row_size =
+      (row_size + alignment - 1) / alignment * alignment;
+  return (aligned_row_size + sizeof(T) - 1) / sizeof(T);
+}
+
+// Byte layout of a dataset file
+struct layout_t {
+  format_t format = format_t::FORMAT_UNKNOWN; // FORMAT_* | HEADER_*
+  std::size_t file_size = 0;
+  std::size_t num_data = 0;
+  std::size_t data_dim = 0;
+  // Byte offset of the first data vector
+  std::size_t data_offset = 0;
+  // Byte distance between the heads of two consecutive data vectors
+  std::size_t row_stride = 0;
+
+  inline std::size_t row_offset(const std::size_t i) const {
+    return data_offset + i * row_stride;
+  }
+};
+
+namespace detail {
+template <class T, class HEADER_T>
+inline layout_t make_layout(const format_t format, const HEADER_T header[2],
+                            const std::size_t file_size) {
+  layout_t layout;
+  layout.file_size = file_size;
+  if ((format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN) {
+    layout.format = format_t::FORMAT_VECS | get_header_t<HEADER_T>();
+    layout.data_dim = header[0];
+    layout.row_stride = sizeof(HEADER_T) + layout.data_dim * sizeof(T);
+    layout.num_data = file_size / layout.row_stride;
+    layout.data_offset = sizeof(HEADER_T);
+  } else if ((format & format_t::FORMAT_BIGANN) != format_t::FORMAT_UNKNOWN) {
+    layout.format = format_t::FORMAT_BIGANN | get_header_t<HEADER_T>();
+    layout.data_dim = header[1];
+    layout.num_data = header[0];
+    layout.row_stride = layout.data_dim * sizeof(T);
+    layout.data_offset = 2 * sizeof(HEADER_T);
+  } else {
+    throw std::runtime_error("Unknown file format");
+  }
+  return layout;
 }
+} // namespace detail
 
 template <class T, class HEADER_T = void>
-inline void load_size_info(std::ifstream &ifs, std::size_t &num_data,
-                           std::size_t &data_dim,
-                           mtk::anns_dataset::format_t format =
-                               mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
-                           const bool print_log = false) {
-  num_data = data_dim = 0;
+inline layout_t
+load_layout(std::ifstream &ifs,
+            const format_t format = format_t::FORMAT_AUTO_DETECT,
+            const bool print_log = false) {
   if constexpr (std::is_same<HEADER_T, void>::value) {
-    const auto detected_format = detect_file_format<T, void>(ifs, print_log);
-    if (detected_format == format_t::FORMAT_UNKNOWN) {
-      throw std::runtime_error("Could not detect the file format");
-      return;
+    auto header_type = format & format_t::HEADER_MASK;
+    auto format_type = format & format_t::FORMAT_MASK;
+    if (header_type == format_t::FORMAT_UNKNOWN) {
+      const auto detected_format = detect_file_format<T, void>(ifs, print_log);
+      if (detected_format == format_t::FORMAT_UNKNOWN) {
+        throw std::runtime_error("Could not detect the file format");
+      }
+      header_type = detected_format & format_t::HEADER_MASK;
+      if (format_type == format_t::FORMAT_AUTO_DETECT ||
+          format_type == format_t::FORMAT_UNKNOWN) {
+        format_type = detected_format & format_t::FORMAT_MASK;
+      }
     }
 
-    const auto detected_header_t = detected_format & format_t::HEADER_MASK;
-    const auto detected_format_t = detected_format & format_t::FORMAT_MASK;
-
-    if (detected_header_t == format_t::HEADER_U32) {
-      load_size_info<T, std::uint32_t>(ifs, num_data, data_dim,
-                                       detected_format_t, print_log);
-    } else {
-      load_size_info<T, std::uint64_t>(ifs, num_data, data_dim,
-                                       detected_format_t, print_log);
+    if (header_type == format_t::HEADER_U64) {
+      return load_layout<T, std::uint64_t>(ifs, format_type, print_log);
     }
+    return load_layout<T, std::uint32_t>(ifs, format_type, print_log);
   } else {
-    const auto current_pos = ifs.tellg();
-    num_data = 0;
-    data_dim = 0;
-
-    if (print_log) {
-      std::printf("[ANNS-DS %s]: Given format / mode = %s\n", __func__,
-                  get_format_str(format).c_str());
-      std::fflush(stdout);
+    if (!ifs) {
+      throw std::runtime_error("Invalid ifstream");
     }
+    const auto current_pos = ifs.tellg();
 
-    // Calculate file size
     ifs.seekg(0, ifs.end);
     const auto file_size = static_cast<std::size_t>(ifs.tellg());
     ifs.seekg(0, ifs.beg);
 
-    ifs.seekg(current_pos);
     HEADER_T header[2];
     ifs.read(reinterpret_cast<char *>(header), sizeof(header));
 
-    if (format == format_t::FORMAT_AUTO_DETECT) {
-      if ((format = detect_file_format<T, HEADER_T>(ifs, print_log)) ==
+    auto format_ = format & format_t::FORMAT_MASK;
+    if (format_ == format_t::FORMAT_AUTO_DETECT ||
+        format_ == format_t::FORMAT_UNKNOWN) {
+      if ((format_ = detect_file_format<T, HEADER_T>(ifs, print_log)) ==
           format_t::FORMAT_UNKNOWN) {
         throw std::runtime_error("Could not detect the file format");
       }
     }
+    ifs.seekg(current_pos);
 
-    if ((format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN) {
-      data_dim = header[0];
-      num_data = file_size / (sizeof(HEADER_T) + data_dim * sizeof(T));
-    } else if ((format & format_t::FORMAT_BIGANN) != format_t::FORMAT_UNKNOWN) {
-      data_dim = header[1];
-      num_data = header[0];
-    } else {
-      throw std::runtime_error("Unknown file format");
+    const auto layout =
+        detail::make_layout<T, HEADER_T>(format_, header, file_size);
+    if (print_log) {
+      std::printf("[ANNS-DS %s]: Format = %s, num data = %zu, dim = %zu\n",
+                  __func__, get_format_str(layout.format).c_str(),
+                  layout.num_data, layout.data_dim);
+      std::fflush(stdout);
     }
-    ifs.seekg(current_pos);
+    return layout;
   }
 }
 
-template <class T, class HEADER_T = void>
-inline void load_size_info(const std::string file_path, std::size_t &num_data,
-                           std::size_t &data_dim,
-                           mtk::anns_dataset::format_t format =
-                               mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
-                           const bool print_log = false) {
-  std::ifstream ifs(file_path);
+template <class T> inline std::string get_type_str() { return "UNKNOWN"; }
+template <> inline std::string get_type_str<float>() { return "F32"; }
+template <> inline std::string get_type_str<double>() { return "F64"; }
+template <> inline std::string get_type_str<float16_t>() { return "F16"; }
+template <> inline std::string get_type_str<bfloat16_t>() { return "BF16"; }
+template <> inline std::string get_type_str<std::int8_t>() { return "I8"; }
+template <> inline std::string get_type_str<std::uint8_t>() { return "U8"; }
+template <> inline std::string get_type_str<std::int16_t>() { return "I16"; }
+template <> inline std::string get_type_str<std::uint16_t>() { return "U16"; }
+template <> inline std::string get_type_str<std::int32_t>() { return "I32"; }
+template <> inline std::string get_type_str<std::uint32_t>() { return "U32"; }
+template <> inline std::string get_type_str<std::int64_t>() { return "I64"; }
+template <> inline std::string get_type_str<std::uint64_t>() { return "U64"; }
+
+// Sidecar metadata (`<file_path>.meta`) of a dataset file. It is used instead
+// of detecting the format when the file size and the modification time match.
+struct metadata_t {
+  layout_t layout;
+  std::size_t element_size = 0;
+  std::string element_type;
+  std::uint64_t mtime_ns = 0;
+  // FNV-1a hash of the first `detail::metadata_checksum_bytes` bytes
+  std::uint64_t checksum = 0;
+};
+
+inline std::string get_metadata_path(const std::string &file_path) {
+  return file_path + ".meta";
+}
+
+namespace detail {
+constexpr std::size_t metadata_checksum_bytes = 4lu << 10;
+constexpr std::uint32_t metadata_version = 1;
+
+inline std::uint64_t fnv1a64(const void *const ptr, const std::size_t size,
+                             std::uint64_t hash = 0xcbf29ce484222325lu) {
+  const auto p = static_cast<const std::uint8_t *>(ptr);
+  for (std::size_t i = 0; i < size; i++) {
+    hash = (hash ^ p[i]) * 0x100000001b3lu;
+  }
+  return hash;
+}
+
+inline bool get_file_stat(const std::string &file_path, std::size_t &file_size,
+                          std::uint64_t &mtime_ns) {
+  struct stat st;
+  if (::stat(file_path.c_str(), &st) != 0) {
+    return false;
+  }
+  file_size = st.st_size;
+  mtime_ns = static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000lu +
+             st.st_mtim.tv_nsec;
+  return true;
+}
+
+inline std::uint64_t compute_file_checksum(const std::string &file_path) {
+  std::ifstream ifs(file_path, std::ios::binary);
   if (!ifs) {
     throw std::runtime_error("No such file: " + file_path);
   }
+  char buffer[metadata_checksum_bytes];
+  ifs.read(buffer, sizeof(buffer));
+  return fnv1a64(buffer, ifs.gcount());
+}
 
-  if (print_log) {
-    std::printf("[ANNS-DS %s]: Given format / mode = %s\n", __func__,
-                get_format_str(format).c_str());
-    std::fflush(stdout);
+template <class HEADER_T> inline format_t get_header_mask() {
+  if constexpr (std::is_same<HEADER_T, void>::value) {
+    return format_t::FORMAT_UNKNOWN;
+  } else {
+    return get_header_t<HEADER_T>();
   }
-  load_size_info<T, HEADER_T>(ifs, num_data, data_dim, format, print_log);
-  ifs.close();
 }
 
-template <class T, class HEADER_T = void>
-inline std::pair<std::size_t, std::size_t>
-load_size_info(std::ifstream &ifs,
-               const format_t format = format_t::FORMAT_AUTO_DETECT,
-               const bool print_log = false) {
-  std::size_t data_dim, num_data;
+// Returns true if `layout` can be used for the requested format
+inline bool is_compatible_format(const layout_t &layout,
+                                 const format_t format) {
+  const auto format_type = format & format_t::FORMAT_MASK;
+  const auto header_type = format & format_t::HEADER_MASK;
+  return (format_type == format_t::FORMAT_AUTO_DETECT ||
+          format_type == format_t::FORMAT_UNKNOWN ||
+          format_type == (layout.format & format_t::FORMAT_MASK)) &&
+         (header_type == format_t::FORMAT_UNKNOWN ||
+          header_type == (layout.format & format_t::HEADER_MASK));
+}
+} // namespace detail
 
-  load_size_info<T, HEADER_T>(ifs, num_data, data_dim, format, print_log);
+inline void store_metadata(const std::string &file_path,
+                           const layout_t &layout,
+                           const std::size_t element_size,
+                           const std::string element_type,
+                           const bool print_log = false) {
+  std::size_t file_size;
+  std::uint64_t mtime_ns;
+  if (!detail::get_file_stat(file_path, file_size, mtime_ns)) {
+    throw std::runtime_error("No such file: " + file_path);
+  }
 
-  if (data_dim == 0 && num_data == 0) {
-    throw std::runtime_error("Invalid file format");
+  const auto metadata_path = get_metadata_path(file_path);
+  std::ofstream ofs(metadata_path);
+  if (!ofs) {
+    throw std::runtime_error("[ANNS-DS store]: Failed to open " +
+                             metadata_path);
   }
+  ofs << "version " << detail::metadata_version << "\n"
+      << "format " << static_cast<std::uint32_t>(layout.format) << "\n"
+      << "header_size "
+      << ((layout.format & format_t::HEADER_MASK) == format_t::HEADER_U64
+              ? sizeof(std::uint64_t)
+              : sizeof(std::uint32_t))
+      << "\n"
+      << "element_size " << element_size << "\n"
+      << "element_type " << element_type << "\n"
+      << "num_data " << layout.num_data << "\n"
+      << "data_dim " << layout.data_dim << "\n"
+      << "data_offset " << layout.data_offset << "\n"
+      << "row_stride " << layout.row_stride << "\n"
+      << "file_size " << file_size << "\n"
+      << "mtime_ns " << mtime_ns << "\n"
+      << "checksum " << detail::compute_file_checksum(file_path) << "\n";
+  ofs.close();
 
-  return std::make_pair(num_data, data_dim);
+  if (print_log) {
+    std::printf("[ANNS-DS %s]: Metadata path = %s (%s)\n", __func__,
+                metadata_path.c_str(), get_format_str(layout.format).c_str());
+    std::fflush(stdout);
+  }
 }
 
-template <class T, class HEADER_T = void>
-inline std::pair<std::size_t, std::size_t>
-load_size_info(const std::string file_path,
-               const format_t format = format_t::FORMAT_AUTO_DETECT,
-               const bool print_log = false) {
-  std::size_t data_dim, num_data;
-
-  load_size_info<T, HEADER_T>(file_path, num_data, data_dim, format, print_log);
-
-  if (data_dim == 0 && num_data == 0) {
+template <class T>
+inline void store_metadata(const std::string &file_path,
+                           const format_t format = format_t::FORMAT_AUTO_DETECT,
+                           const bool print_log = false) {
+  // Detect the layout from the dataset file itself
+  std::ifstream ifs(file_path);
+  if (!ifs) {
     throw std::runtime_error("No such file: " + file_path);
   }
-
-  return std::make_pair(num_data, data_dim);
+  const auto layout = load_layout<T>(ifs, format, print_log);
+  ifs.close();
+  store_metadata(file_path, layout, sizeof(T), get_type_str<T>(), print_log);
 }
 
-template <class MEM_T, class T = MEM_T, class HEADER_T = void>
-int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
-         const format_t format = format_t::FORMAT_AUTO_DETECT,
-         const range_t range = range_t{.offset = 0, .size = 0}) {
+// Returns false if there is no valid metadata of `file_path`
+inline bool load_metadata(const std::string &file_path, metadata_t &metadata,
+                          const bool verify_checksum = false) {
+  std::ifstream ifs(get_metadata_path(file_path));
+  if (!ifs) {
+    return false;
+  }
+
+  std::uint32_t version = 0, format = 0;
+  std::size_t header_size = 0, file_size = 0;
+  std::string key;
+  while (ifs >> key) {
+    if (key == "version") {
+      ifs >> version;
+    } else if (key == "format") {
+      ifs >> format;
+    } else if (key == "header_size") {
+      ifs >> header_size;
+    } else if (key == "element_size") {
+      ifs >> metadata.element_size;
+    } else if (key == "element_type") {
+      ifs >> metadata.element_type;
+    } else if (key == "num_data") {
+      ifs >> metadata.layout.num_data;
+    } else if (key == "data_dim") {
+      ifs >> metadata.layout.data_dim;
+    } else if (key == "data_offset") {
+      ifs >> metadata.layout.data_offset;
+    } else if (key == "row_stride") {
+      ifs >> metadata.layout.row_stride;
+    } else if (key == "file_size") {
+      ifs >> file_size;
+    } else if (key == "mtime_ns") {
+      ifs >> metadata.mtime_ns;
+    } else if (key == "checksum") {
+      ifs >> metadata.checksum;
+    } else {
+      std::string value;
+      ifs >> value;
+    }
+  }
+  metadata.layout.format = static_cast<format_t>(format);
+  metadata.layout.file_size = file_size;
+  if (version != detail::metadata_version ||
+      (metadata.layout.format & format_t::FORMAT_MASK) ==
+          format_t::FORMAT_UNKNOWN) {
+    return false;
+  }
+
+  // Check that the dataset file has not been modified
+  std::size_t current_file_size;
+  std::uint64_t current_mtime_ns;
+  if (!detail::get_file_stat(file_path, current_file_size, current_mtime_ns) ||
+      current_file_size != file_size || current_mtime_ns != metadata.mtime_ns) {
+    return false;
+  }
+  if (verify_checksum &&
+      detail::compute_file_checksum(file_path) != metadata.checksum) {
+    return false;
+  }
+  return true;
+}
+
+// Get the layout from the metadata if it is valid for the element type `T`
+// and the requested format
+template <class T>
+inline bool
+load_metadata(const std::string &file_path, layout_t &layout,
+              const format_t format = format_t::FORMAT_AUTO_DETECT) {
+  metadata_t metadata;
+  if (!load_metadata(file_path, metadata) ||
+      metadata.element_size != sizeof(T) ||
+      !detail::is_compatible_format(metadata.layout, format)) {
+    return false;
+  }
+  layout = metadata.layout;
+  return true;
+}
+
+// Per-dimension affine parameters of a scalar-quantized (SQ8) dataset.
+// The j-th element is decoded as `scale[j] * q + offset[j]`.
+struct sq_params_t {
+  std::string element_type; // "I8" or "U8"
+  std::vector<float> scale;
+  std::vector<float> offset;
+
+  inline std::size_t dim() const { return scale.size(); }
+};
+
+inline std::string get_sq_params_path(const std::string &file_path) {
+  return file_path + ".sq8";
+}
+
+namespace detail {
+constexpr std::uint32_t sq_params_version = 2;
+} // namespace detail
+
+// The parameters are written to the sidecar `<file_path>.sq8`
+inline void store_sq_params(const std::string &file_path,
+                            const sq_params_t &params) {
+  std::size_t file_size;
+  std::uint64_t mtime_ns;
+  if (!detail::get_file_stat(file_path, file_size, mtime_ns)) {
+    throw std::runtime_error("No such file: " + file_path);
+  }
+
+  const auto params_path = get_sq_params_path(file_path);
+  std::ofstream ofs(params_path);
+  if (!ofs) {
+    throw std::runtime_error("[ANNS-DS store]: Failed to open " + params_path);
+  }
+  ofs << "version " << detail::sq_params_version << "\n"
+      << "element_type " << params.element_type << "\n"
+      << "data_dim " << params.dim() << "\n"
+      << "file_size " << file_size << "\n"
+      << "mtime_ns " << mtime_ns << "\n";
+  // Hexadecimal floats are written to keep the exact values
+  char buffer[32];
+  for (const auto p : {&params.scale, &params.offset}) {
+    ofs << (p == &params.scale ? "scale" : "offset");
+    for (const auto v : *p) {
+      std::snprintf(buffer, sizeof(buffer), " %a", v);
+      ofs << buffer;
+    }
+    ofs << "\n";
+  }
+}
+
+// Returns false if `file_path` has no valid SQ8 parameters
+inline bool load_sq_params(const std::string &file_path, sq_params_t &params) {
+  std::ifstream ifs(get_sq_params_path(file_path));
+  if (!ifs) {
+    return false;
+  }
+
+  std::uint32_t version = 0;
+  std::size_t data_dim = 0, file_size = 0;
+  std::uint64_t mtime_ns = 0;
+  std::string key;
+  while (ifs >> key) {
+    if (key == "version") {
+      ifs >> version;
+    } else if (key == "element_type") {
+      ifs >> params.element_type;
+    } else if (key == "data_dim") {
+      ifs >> data_dim;
+    } else if (key == "file_size") {
+      ifs >> file_size;
+    } else if (key == "mtime_ns") {
+      ifs >> mtime_ns;
+    } else if (key == "scale" || key == "offset") {
+      auto &v = key == "scale" ? params.scale : params.offset;
+      v.resize(data_dim);
+      std::string value;
+      for (std::size_t j = 0; j < data_dim && ifs >> value; j++) {
+        v[j] = std::strtof(value.c_str(), nullptr);
+      }
+    } else {
+      std::string value;
+      ifs >> value;
+    }
+  }
+
+  // Check that the dataset file has not been modified
+  std::size_t current_file_size;
+  std::uint64_t current_mtime_ns;
+  return version == detail::sq_params_version && data_dim != 0 &&
+         params.scale.size() == data_dim && params.offset.size() == data_dim &&
+         (params.element_type == "I8" || params.element_type == "U8") &&
+         detail::get_file_stat(file_path, current_file_size,
+                               current_mtime_ns) &&
+         current_file_size == file_size && current_mtime_ns == mtime_ns;
+}
+
+namespace detail {
+// SQ8 datasets are read as float only by the dequantizing `load` and
+// `load_parallel`. Throws if `file_path` is one and T is float.
+template <class T> inline void check_not_sq8(const std::string &file_path) {
+  if constexpr (std::is_same<T, float>::value) {
+    sq_params_t params;
+    if (load_sq_params(file_path, params)) {
+      throw std::runtime_error("SQ8 dataset of " + params.element_type +
+                               " is dequantized only by load and "
+                               "load_parallel");
+    }
+  }
+}
+} // namespace detail
+
+template <class T, class HEADER_T = void>
+inline layout_t
+load_layout(const std::string file_path,
+            const format_t format = format_t::FORMAT_AUTO_DETECT,
+            const bool print_log = false) {
+  detail::check_not_sq8<T>(file_path);
+  layout_t layout;
+  if (load_metadata<T>(file_path, layout,
+                       format | detail::get_header_mask<HEADER_T>())) {
+    return layout;
+  }
+
+  std::ifstream ifs(file_path);
+  if (!ifs) {
+    throw std::runtime_error("No such file: " + file_path);
+  }
+  layout = load_layout<T, HEADER_T>(ifs, format, print_log);
+  ifs.close();
+  return layout;
+}
+
+template <class T, class HEADER_T = void>
+inline void load_size_info(std::ifstream &ifs, std::size_t &num_data,
+                           std::size_t &data_dim,
+                           mtk::anns_dataset::format_t format =
+                               mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+                           const bool print_log = false) {
+  num_data = data_dim = 0;
+  if constexpr (std::is_same<HEADER_T, void>::value) {
+    const auto detected_format = detect_file_format<T, void>(ifs, print_log);
+    if (detected_format == format_t::FORMAT_UNKNOWN) {
+      throw std::runtime_error("Could not detect the file format");
+      return;
+    }
+
+    const auto detected_header_t = detected_format & format_t::HEADER_MASK;
+    const auto detected_format_t = detected_format & format_t::FORMAT_MASK;
+
+    if (detected_header_t == format_t::HEADER_U32) {
+      load_size_info<T, std::uint32_t>(ifs, num_data, data_dim,
+                                       detected_format_t, print_log);
+    } else {
+      load_size_info<T, std::uint64_t>(ifs, num_data, data_dim,
+                                       detected_format_t, print_log);
+    }
+  } else {
+    const auto current_pos = ifs.tellg();
+    num_data = 0;
+    data_dim = 0;
+
+    if (print_log) {
+      std::printf("[ANNS-DS %s]: Given format / mode = %s\n", __func__,
+                  get_format_str(format).c_str());
+      std::fflush(stdout);
+    }
+
+    // Calculate file size
+    ifs.seekg(0, ifs.end);
+    const auto file_size = static_cast<std::size_t>(ifs.tellg());
+    ifs.seekg(0, ifs.beg);
+
+    ifs.seekg(current_pos);
+    HEADER_T header[2];
+    ifs.read(reinterpret_cast<char *>(header), sizeof(header));
+
+    if (format == format_t::FORMAT_AUTO_DETECT) {
+      if ((format = detect_file_format<T, HEADER_T>(ifs, print_log)) ==
+          format_t::FORMAT_UNKNOWN) {
+        throw std::runtime_error("Could not detect the file format");
+      }
+    }
+
+    if ((format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN) {
+      data_dim = header[0];
+      num_data = file_size / (sizeof(HEADER_T) + data_dim * sizeof(T));
+    } else if ((format & format_t::FORMAT_BIGANN) != format_t::FORMAT_UNKNOWN) {
+      data_dim = header[1];
+      num_data = header[0];
+    } else {
+      throw std::runtime_error("Unknown file format");
+    }
+    ifs.seekg(current_pos);
+  }
+}
+
+template <class T, class HEADER_T = void>
+inline void load_size_info(const std::string file_path, std::size_t &num_data,
+                           std::size_t &data_dim,
+                           mtk::anns_dataset::format_t format =
+                               mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+                           const bool print_log = false) {
+  // The size of an SQ8 dataset loaded as float is that of its 8-bit file
+  if constexpr (std::is_same<T, float>::value) {
+    sq_params_t params;
+    if (load_sq_params(file_path, params)) {
+      load_size_info<std::uint8_t, HEADER_T>(file_path, num_data, data_dim,
+                                             format, print_log);
+      return;
+    }
+  }
+
+  layout_t layout;
+  if (load_metadata<T>(file_path, layout,
+                       format | detail::get_header_mask<HEADER_T>())) {
+    num_data = layout.num_data;
+    data_dim = layout.data_dim;
+    return;
+  }
+
+  std::ifstream ifs(file_path);
+  if (!ifs) {
+    throw std::runtime_error("No such file: " + file_path);
+  }
+
+  if (print_log) {
+    std::printf("[ANNS-DS %s]: Given format / mode = %s\n", __func__,
+                get_format_str(format).c_str());
+    std::fflush(stdout);
+  }
+  load_size_info<T, HEADER_T>(ifs, num_data, data_dim, format, print_log);
+  ifs.close();
+}
+
+template <class T, class HEADER_T = void>
+inline std::pair<std::size_t, std::size_t>
+load_size_info(std::ifstream &ifs,
+               const format_t format = format_t::FORMAT_AUTO_DETECT,
+               const bool print_log = false) {
+  std::size_t data_dim, num_data;
+
+  load_size_info<T, HEADER_T>(ifs, num_data, data_dim, format, print_log);
+
+  if (data_dim == 0 && num_data == 0) {
+    throw std::runtime_error("Invalid file format");
+  }
+
+  return std::make_pair(num_data, data_dim);
+}
+
+template <class T, class HEADER_T = void>
+inline std::pair<std::size_t, std::size_t>
+load_size_info(const std::string file_path,
+               const format_t format = format_t::FORMAT_AUTO_DETECT,
+               const bool print_log = false) {
+  std::size_t data_dim, num_data;
+
+  load_size_info<T, HEADER_T>(file_path, num_data, data_dim, format, print_log);
+
+  if (data_dim == 0 && num_data == 0) {
+    throw std::runtime_error("No such file: " + file_path);
+  }
+
+  return std::make_pair(num_data, data_dim);
+}
+
+namespace detail {
+// Read `size` bytes at `offset` of `fd`, retrying on short reads
+inline void pread_all(const int fd, void *const ptr, const std::size_t size,
+                      const std::size_t offset) {
+  auto dst = static_cast<char *>(ptr);
+  std::size_t done = 0;
+  while (done < size) {
+    const auto res = ::pread(fd, dst + done, size - done, offset + done);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("pread failed (" +
+                               std::string(std::strerror(errno)) + ")");
+    }
+    if (res == 0) {
+      throw std::runtime_error("Unexpected end of file");
+    }
+    done += static_cast<std::size_t>(res);
+  }
+}
+
+// Write `size` bytes at `offset` of `fd`, retrying on short writes
+inline void pwrite_all(const int fd, const void *const ptr,
+                       const std::size_t size, const std::size_t offset) {
+  const auto src = static_cast<const char *>(ptr);
+  std::size_t done = 0;
+  while (done < size) {
+    const auto res = ::pwrite(fd, src + done, size - done, offset + done);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("pwrite failed (" +
+                               std::string(std::strerror(errno)) + ")");
+    }
+    done += static_cast<std::size_t>(res);
+  }
+}
+
+inline unsigned get_num_threads(const unsigned num_threads) {
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Fill the elements [data_dim, ldd) of each vector with `padding_value`
+template <class MEM_T>
+inline void fill_padding(MEM_T *const dst, const std::size_t ldd,
+                         const std::size_t num_rows,
+                         const std::size_t data_dim,
+                         const MEM_T padding_value) {
+  if (ldd <= data_dim) {
+    return;
+  }
+  for (std::size_t i = 0; i < num_rows; i++) {
+    std::fill(dst + i * ldd + data_dim, dst + (i + 1) * ldd, padding_value);
+  }
+}
+
+// Copy `num_rows` vectors of `data_dim` elements from a raw file block whose
+// vectors are `src_stride` bytes apart into `dst` (leading dimension `ldd`)
+template <class MEM_T, class T>
+inline void copy_rows(MEM_T *const dst, const std::size_t ldd,
+                      const char *const src, const std::size_t src_stride,
+                      const std::size_t num_rows, const std::size_t data_dim) {
+  if (src_stride == sizeof(T) * data_dim && ldd == data_dim) {
+    // Contiguous block
+    if constexpr (std::is_same<T, MEM_T>::value) {
+      std::memcpy(dst, src, sizeof(T) * data_dim * num_rows);
+    } else {
+      convert(dst, reinterpret_cast<const T *>(src), data_dim * num_rows);
+    }
+    return;
+  }
+  for (std::size_t i = 0; i < num_rows; i++) {
+    const auto src_row = src + i * src_stride;
+    const auto dst_row = dst + i * ldd;
+    if constexpr (std::is_same<T, MEM_T>::value) {
+      std::memcpy(dst_row, src_row, sizeof(T) * data_dim);
+    } else {
+      convert(dst_row, reinterpret_cast<const T *>(src_row), data_dim);
+    }
+  }
+}
+
+// Run `func(begin, end)` for every `chunk_size`-sized piece of [0, n) on
+// `num_threads` threads
+template <class Func>
+inline void parallel_for_chunks(const std::size_t n,
+                                const std::size_t chunk_size,
+                                const unsigned num_threads, Func func) {
+  const auto num_chunks = (n + chunk_size - 1) / chunk_size;
+  const auto num_workers = static_cast<unsigned>(
+      std::min<std::size_t>(get_num_threads(num_threads), num_chunks));
+  if (num_workers <= 1) {
+    for (std::size_t c = 0; c < num_chunks; c++) {
+      func(c * chunk_size, std::min(n, (c + 1) * chunk_size));
+    }
+    return;
+  }
+
+  std::atomic<std::size_t> next_chunk(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < num_workers; t++) {
+    workers.emplace_back([&]() {
+      try {
+        std::size_t c;
+        while ((c = next_chunk.fetch_add(1)) < num_chunks) {
+          func(c * chunk_size, std::min(n, (c + 1) * chunk_size));
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next_chunk = num_chunks;
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Returns the index of the first vector whose header is not `data_dim`, or
+// `num_rows` if all headers are valid
+template <class HEADER_T>
+inline std::size_t find_invalid_vecs_header(const char *const src,
+                                            const std::size_t src_stride,
+                                            const std::size_t num_rows,
+                                            const std::size_t data_dim) {
+  for (std::size_t i = 0; i < num_rows; i++) {
+    HEADER_T header;
+    std::memcpy(&header, src + i * src_stride, sizeof(HEADER_T));
+    if (static_cast<std::size_t>(header) != data_dim) {
+      return i;
+    }
+  }
+  return num_rows;
+}
+
+// Read `num_rows` vectors starting from the `first_row`-th vector of `fd`
+// into `dst` (leading dimension `ldd`). `staging` is used as a temporary
+// buffer when the vectors cannot be read into `dst` directly.
+template <class MEM_T, class T>
+inline void read_rows(const int fd, const layout_t &layout,
+                      const std::size_t first_row, const std::size_t num_rows,
+                      MEM_T *const dst, const std::size_t ldd,
+                      std::vector<char> &staging,
+                      const bool check_vecs_header = false,
+                      const MEM_T padding_value = MEM_T(0),
+                      io_monitor *const monitor = nullptr) {
+  if (num_rows == 0) {
+    return;
+  }
+  const auto data_dim = layout.data_dim;
+  const bool is_vecs =
+      (layout.format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN;
+  const auto file_offset = layout.row_offset(first_row);
+  const bool monitored = monitor != nullptr && monitor->enabled();
+  const auto t0 = monitored ? io_monitor::now() : io_monitor::time_point{};
+
+  // BIGANN vectors are contiguous and can be read straight into `dst`
+  if (std::is_same<T, MEM_T>::value && !is_vecs && ldd == data_dim) {
+    pread_all(fd, dst, num_rows * data_dim * sizeof(T), file_offset);
+    if (monitored) {
+      const auto t1 = io_monitor::now();
+      monitor->add_read(num_rows * data_dim * sizeof(T), num_rows, t0, t1);
+    }
+    return;
+  }
+
+  // Read whole vectors including the VECS headers
+  const std::size_t header_bytes = is_vecs ? layout.data_offset : 0;
+  const auto block_bytes = num_rows * layout.row_stride;
+  if (staging.size() < block_bytes) {
+    staging.resize(block_bytes);
+  }
+  pread_all(fd, staging.data(), block_bytes, file_offset - header_bytes);
+  const auto t1 = monitored ? io_monitor::now() : io_monitor::time_point{};
+  if (is_vecs && check_vecs_header) {
+    const auto invalid_row =
+        header_bytes == sizeof(std::uint64_t)
+            ? find_invalid_vecs_header<std::uint64_t>(
+                  staging.data(), layout.row_stride, num_rows, data_dim)
+            : find_invalid_vecs_header<std::uint32_t>(
+                  staging.data(), layout.row_stride, num_rows, data_dim);
+    if (invalid_row < num_rows) {
+      throw std::runtime_error("Invalid header at vector " +
+                               std::to_string(first_row + invalid_row));
+    }
+  }
+  copy_rows<MEM_T, T>(dst, ldd, staging.data() + header_bytes,
+                      layout.row_stride, num_rows, data_dim);
+  fill_padding(dst, ldd, num_rows, data_dim, padding_value);
+  if (monitored) {
+    monitor->add_read(block_bytes, num_rows, t0, t1);
+  }
+}
+
+constexpr std::size_t load_block_bytes = 8lu << 20;
+constexpr std::size_t parallel_load_chunk_bytes = 16lu << 20;
+
+// Rows whose skipped part is smaller than this are read as a whole when
+// loading a subset of dimensions
+constexpr std::size_t projection_min_skip_bytes = 4lu << 10;
+
+// Copy the `projection` dimensions of `num_rows` vectors. `src` points to the
+// `col_begin`-th element of the first vector.
+template <class MEM_T, class T>
+inline void project_rows(MEM_T *const dst, const std::size_t ldd,
+                         const char *const src, const std::size_t src_stride,
+                         const std::size_t num_rows,
+                         const projection_t &projection,
+                         const std::size_t col_begin,
+                         const std::size_t data_dim) {
+  if (projection.indices.empty()) {
+    copy_rows<MEM_T, T>(dst, ldd,
+                        src + (projection.offset - col_begin) * sizeof(T),
+                        src_stride, num_rows, projection.get_dim(data_dim));
+    return;
+  }
+  for (std::size_t i = 0; i < num_rows; i++) {
+    const auto src_row = reinterpret_cast<const T *>(src + i * src_stride);
+    for (std::size_t k = 0; k < projection.indices.size(); k++) {
+      dst[i * ldd + k] =
+          static_cast<MEM_T>(src_row[projection.indices[k] - col_begin]);
+    }
+  }
+}
+
+template <class MEM_T, class T>
+inline int load_projection(MEM_T *const ptr, std::ifstream &ifs,
+                           const layout_t &layout, const range_t range,
+                           const projection_t &projection,
+                           const std::size_t ldd, const MEM_T padding_value,
+                           const bool print_log) {
+  const auto data_dim = layout.data_dim;
+  const auto [col_begin, col_end] = projection.get_span(data_dim);
+  if (col_end > data_dim || col_begin >= col_end) {
+    std::fprintf(stderr, "[ANNS-DS load]: Invalid projection\n");
+    return 1;
+  }
+  if (!range.is_valid(layout.num_data)) {
+    std::fprintf(stderr, "[ANNS-DS load]: Out of range\n");
+    return 1;
+  }
+  const auto proj_dim = projection.get_dim(data_dim);
+  const auto dst_ld = ldd == 0 ? proj_dim : ldd;
+  const auto num_load_vecs = range.get_size(layout.num_data);
+
+  const auto span_bytes = (col_end - col_begin) * sizeof(T);
+  const bool strided_read =
+      layout.row_stride - span_bytes >= projection_min_skip_bytes;
+  if (print_log) {
+    std::printf("[ANNS-DS load]: Projection dim = %zu, %s reads\n", proj_dim,
+                strided_read ? "strided" : "full-row");
+    std::fflush(stdout);
+  }
+
+  std::vector<char> buffer;
+  if (strided_read) {
+    // Read only the covering window of each vector
+    buffer.resize(span_bytes);
+    for (std::size_t i = 0; i < num_load_vecs; i++) {
+      ifs.seekg(layout.row_offset(range.offset + i) + col_begin * sizeof(T));
+      ifs.read(buffer.data(), span_bytes);
+      project_rows<MEM_T, T>(ptr + i * dst_ld, dst_ld, buffer.data(),
+                             span_bytes, 1, projection, col_begin, data_dim);
+    }
+  } else {
+    const bool is_vecs =
+        (layout.format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN;
+    const std::size_t header_bytes = is_vecs ? layout.data_offset : 0;
+    const auto block_size = std::min<std::size_t>(
+        num_load_vecs,
+        std::max<std::size_t>(1, load_block_bytes / layout.row_stride));
+    buffer.resize(block_size * layout.row_stride);
+    ifs.seekg(layout.row_offset(range.offset) - header_bytes);
+    for (std::size_t i = 0; i < num_load_vecs; i += block_size) {
+      const auto num_rows = std::min(block_size, num_load_vecs - i);
+      ifs.read(buffer.data(), num_rows * layout.row_stride);
+      project_rows<MEM_T, T>(
+          ptr + i * dst_ld, dst_ld,
+          buffer.data() + header_bytes + col_begin * sizeof(T),
+          layout.row_stride, num_rows, projection, col_begin, data_dim);
+    }
+  }
+  if (!ifs) {
+    std::fprintf(stderr, "[ANNS-DS load]: Failed to read the dataset\n");
+    return 1;
+  }
+  fill_padding(ptr, dst_ld, num_load_vecs, proj_dim, padding_value);
+  return 0;
+}
+
+} // namespace detail
+
+namespace detail {
+// dst[i * ldd + j] = scale[j] * src[i * dim + j] + offset[j]
+template <class Q>
+inline void dequantize_rows(float *const dst, const std::size_t ldd,
+                            const Q *const src, const std::size_t num_rows,
+                            const std::size_t dim, const float *const scale,
+                            const float *const offset) {
+  for (std::size_t i = 0; i < num_rows; i++) {
+    dequantize_kernel<Q>::run(dst + i * ldd, src + i * dim, scale, offset,
+                              dim);
+  }
+}
+
+// Load the SQ8 dataset `file_path` into `ptr` as float
+template <class Q>
+int load_dequantize(float *const ptr, const std::string file_path,
+                    const sq_params_t &params, const unsigned num_threads,
+                    const bool print_log, const format_t format,
+                    const range_t range, const std::size_t ldd,
+                    const float padding_value, const projection_t &projection,
+                    const bool check_vecs_header, io_observer *const observer) {
+  layout_t layout;
+  try {
+    layout = load_layout<Q>(file_path, format, print_log);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS load]: %s (%s)\n", e.what(),
+                 file_path.c_str());
+    return 1;
+  }
+  if (layout.data_dim != params.dim()) {
+    std::fprintf(stderr, "[ANNS-DS load]: Inconsistent SQ8 parameters (%s)\n",
+                 file_path.c_str());
+    return 1;
+  }
+  if (!range.is_valid(layout.num_data)) {
+    std::fprintf(stderr, "[ANNS-DS load]: Out of range (%s)\n",
+                 file_path.c_str());
+    return 1;
+  }
+  const auto num_load_vecs = range.get_size(layout.num_data);
+
+  // Parameters of the loaded dimensions
+  const auto [col_begin, col_end] = projection.get_span(layout.data_dim);
+  if (col_end > layout.data_dim || col_begin >= col_end) {
+    std::fprintf(stderr, "[ANNS-DS load]: Invalid projection\n");
+    return 1;
+  }
+  const auto proj_dim = projection.get_dim(layout.data_dim);
+  std::vector<float> scale(proj_dim), offset(proj_dim);
+  for (std::size_t j = 0; j < proj_dim; j++) {
+    const auto k = projection.indices.empty() ? projection.offset + j
+                                              : projection.indices[j];
+    scale[j] = params.scale[k];
+    offset[j] = params.offset[k];
+  }
+  const auto dst_ld = ldd == 0 ? proj_dim : ldd;
+
+  if (print_log) {
+    std::printf("[ANNS-DS load]: Dequantizing %s (%s)\n", file_path.c_str(),
+                params.element_type.c_str());
+    std::fflush(stdout);
+  }
+
+  io_monitor monitor(observer, num_load_vecs, print_log, "load", "Loading");
+  if (!projection.is_full(layout.data_dim)) {
+    std::ifstream ifs(file_path);
+    std::vector<Q> block(
+        std::min(num_load_vecs, std::max<std::size_t>(
+                                    1, load_block_bytes / layout.row_stride)) *
+        proj_dim);
+    const auto block_size = block.size() / std::max<std::size_t>(1, proj_dim);
+    for (std::size_t i = 0; i < num_load_vecs; i += block_size) {
+      const auto n = std::min(block_size, num_load_vecs - i);
+      const auto t0 = monitor.get_time();
+      if (load_projection<Q, Q>(block.data(), ifs, layout,
+                                range_t{.offset = range.offset + i, .size = n},
+                                projection, proj_dim, Q(0), false)) {
+        return 1;
+      }
+      const auto t1 = monitor.get_time();
+      dequantize_rows(ptr + i * dst_ld, dst_ld, block.data(), n, proj_dim,
+                      scale.data(), offset.data());
+      fill_padding(ptr + i * dst_ld, dst_ld, n, proj_dim, padding_value);
+      monitor.add_read(n * proj_dim * sizeof(Q), n, t0, t1);
+    }
+    monitor.complete();
+    return 0;
+  }
+
+  const int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::fprintf(stderr, "No such file : %s\n", file_path.c_str());
+    return 1;
+  }
+  const auto chunk_size = std::max<std::size_t>(
+      1,
+      parallel_load_chunk_bytes / std::max<std::size_t>(1, layout.row_stride));
+  int res = 0;
+  try {
+    parallel_for_chunks(
+        num_load_vecs, chunk_size, num_threads,
+        [&](const std::size_t begin, const std::size_t end) {
+          std::vector<char> staging;
+          std::vector<Q> block((end - begin) * proj_dim);
+          const auto t0 = monitor.get_time();
+          read_rows<Q, Q>(fd, layout, range.offset + begin, end - begin,
+                          block.data(), proj_dim, staging, check_vecs_header);
+          const auto t1 = monitor.get_time();
+          dequantize_rows(ptr + begin * dst_ld, dst_ld, block.data(),
+                          end - begin, proj_dim, scale.data(), offset.data());
+          fill_padding(ptr + begin * dst_ld, dst_ld, end - begin, proj_dim,
+                       padding_value);
+          monitor.add_read((end - begin) * layout.row_stride, end - begin, t0,
+                           t1);
+        });
+    monitor.complete();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS load]: %s (%s)\n", e.what(),
+                 file_path.c_str());
+    res = 1;
+  }
+  ::close(fd);
+  return res;
+}
+
+// Returns -1 if `file_path` is not an SQ8 dataset and the result of the load
+// otherwise
+inline int load_sq8(float *const ptr, const std::string file_path,
+                    const unsigned num_threads, const bool print_log,
+                    const format_t format, const range_t range,
+                    const std::size_t ldd, const float padding_value,
+                    const projection_t &projection,
+                    const bool check_vecs_header = false,
+                    io_observer *const observer = nullptr) {
+  sq_params_t params;
+  if (!load_sq_params(file_path, params)) {
+    return -1;
+  }
+  if (params.element_type == "U8") {
+    return load_dequantize<std::uint8_t>(
+        ptr, file_path, params, num_threads, print_log, format, range, ldd,
+        padding_value, projection, check_vecs_header, observer);
+  }
+  return load_dequantize<std::int8_t>(
+      ptr, file_path, params, num_threads, print_log, format, range, ldd,
+      padding_value, projection, check_vecs_header, observer);
+}
+} // namespace detail
+
+template <class MEM_T, class T = MEM_T, class HEADER_T = void>
+int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
+         const format_t format = format_t::FORMAT_AUTO_DETECT,
+         const range_t range = range_t{.offset = 0, .size = 0},
+         const bool check_vecs_header = false, const std::size_t ldd = 0,
+         const MEM_T padding_value = MEM_T(0),
+         const projection_t &projection = projection_t{},
+         io_observer *const observer = nullptr) {
   if constexpr (std::is_same<HEADER_T, void>::value) {
     const auto detected_format = detect_file_format<T, void>(ifs, print_log);
     if (detected_format == format_t::FORMAT_UNKNOWN) {
@@ -276,12 +1771,17 @@ int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
     const auto detected_header_t = detected_format & format_t::HEADER_MASK;
     const auto detected_format_t = detected_format & format_t::FORMAT_MASK;
 
-    const auto f =
-        format == format_t::FORMAT_AUTO_DETECT ? detected_format_t : format;
+    const auto f = format == format_t::FORMAT_AUTO_DETECT
+                       ? detected_format_t
+                       : format & format_t::FORMAT_MASK;
     if (detected_header_t == format_t::HEADER_U32) {
-      load<MEM_T, T, std::uint32_t>(ptr, ifs, print_log, f, range);
+      return load<MEM_T, T, std::uint32_t>(ptr, ifs, print_log, f, range,
+                                           check_vecs_header, ldd,
+                                           padding_value, projection, observer);
     } else {
-      load<MEM_T, T, std::uint64_t>(ptr, ifs, print_log, f, range);
+      return load<MEM_T, T, std::uint64_t>(ptr, ifs, print_log, f, range,
+                                           check_vecs_header, ldd,
+                                           padding_value, projection, observer);
     }
   } else {
     if (!ifs) {
@@ -304,7 +1804,7 @@ int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
     HEADER_T header[2];
     ifs.read(reinterpret_cast<char *>(header), sizeof(header));
 
-    format_t format_ = format;
+    format_t format_ = format & format_t::FORMAT_MASK;
     if (format == format_t::FORMAT_AUTO_DETECT) {
       if (detail::is_bigann<T, HEADER_T>(header, file_size)) {
         format_ = format_t::FORMAT_BIGANN;
@@ -330,22 +1830,94 @@ int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
       std::printf("\n");
     }
 
-    constexpr auto loading_progress_interval = 1000;
+    if (!projection.is_full(format_ == format_t::FORMAT_VECS ? header[0]
+                                                             : header[1])) {
+      const auto layout =
+          detail::make_layout<T, HEADER_T>(format_, header, file_size);
+      return detail::load_projection<MEM_T, T>(ptr, ifs, layout, range,
+                                               projection, ldd, padding_value,
+                                               print_log);
+    }
+
     if (format_ == format_t::FORMAT_VECS) {
       const std::size_t data_dim = header[0];
       const std::size_t num_data =
           file_size / (sizeof(HEADER_T) + data_dim * sizeof(T));
 
-      std::unique_ptr<T[]> buffer;
-      if constexpr (!std::is_same<T, MEM_T>::value) {
-        buffer = std::unique_ptr<T[]>(new T[data_dim]);
+      const std::size_t row_stride = sizeof(HEADER_T) + data_dim * sizeof(T);
+      const std::size_t dst_ld = ldd == 0 ? data_dim : ldd;
+
+      // Set load offset
+      if (!range.is_valid(num_data)) {
+        std::fprintf(stderr, "[ANNS-DS %s]: Out of range\n", __func__);
+        return 1;
+      }
+      const auto num_load_vecs = range.get_size(num_data);
+      ifs.seekg(range.offset * row_stride, std::ios_base::beg);
+
+      if (print_log) {
+        std::printf("[ANNS-DS %s]: Dataset dimension = %zu\n", __func__,
+                    data_dim);
+        std::printf("[ANNS-DS %s]: Num data = %zu\n", __func__, num_data);
+        std::printf("[ANNS-DS %s]: Num load data = %zu, offset = %zu\n",
+                    __func__, num_load_vecs, range.offset);
+        std::fflush(stdout);
+      }
+
+      // Load multiple vectors at once and strip the headers in memory
+      const auto block_size = std::min<std::size_t>(
+          num_load_vecs,
+          std::max<std::size_t>(1, detail::load_block_bytes / row_stride));
+      std::unique_ptr<char[]> buffer(new char[block_size * row_stride]);
+      detail::io_monitor monitor(observer, num_load_vecs, print_log, __func__,
+                                 "Loading");
+      for (std::size_t i = 0; i < num_load_vecs; i += block_size) {
+        const auto num_rows = std::min(block_size, num_load_vecs - i);
+        const auto t0 = monitor.get_time();
+        ifs.read(buffer.get(), num_rows * row_stride);
+        const auto t1 = monitor.get_time();
+        if (!ifs) {
+          std::fprintf(stderr, "[ANNS-DS %s]: Failed to read the dataset\n",
+                       __func__);
+          return 1;
+        }
+
+        if (check_vecs_header) {
+          const auto invalid_row = detail::find_invalid_vecs_header<HEADER_T>(
+              buffer.get(), row_stride, num_rows, data_dim);
+          if (invalid_row < num_rows) {
+            std::fprintf(stderr,
+                         "[ANNS-DS %s]: Invalid header at vector %zu\n",
+                         __func__, range.offset + i + invalid_row);
+            return 1;
+          }
+        }
+
+        const auto dst = ptr + static_cast<std::uint64_t>(i) * dst_ld;
+        detail::copy_rows<MEM_T, T>(dst, dst_ld,
+                                    buffer.get() + sizeof(HEADER_T),
+                                    row_stride, num_rows, data_dim);
+        detail::fill_padding(dst, dst_ld, num_rows, data_dim, padding_value);
+        monitor.add_read(num_rows * row_stride, num_rows, t0, t1);
       }
+      monitor.complete();
+    } else {
+      const std::size_t data_dim = header[1];
+      const std::size_t num_data = header[0];
+
+      const std::size_t row_size = data_dim * sizeof(T);
+      const std::size_t dst_ld = ldd == 0 ? data_dim : ldd;
+      // Vectors can be read straight into `ptr`
+      const bool direct_read =
+          std::is_same<T, MEM_T>::value && dst_ld == data_dim;
 
       // Set load offset
-      const auto num_load_vecs = range.size == 0 ? num_data : range.size;
-      ifs.seekg(range.offset * (data_dim * sizeof(T) + sizeof(HEADER_T)),
-                std::ios_base::beg);
-      assert(num_load_vecs + range.offset <= num_data);
+      if (!range.is_valid(num_data)) {
+        std::fprintf(stderr, "[ANNS-DS %s]: Out of range\n", __func__);
+        return 1;
+      }
+      const auto num_load_vecs = range.get_size(num_data);
+      ifs.seekg(range.offset * row_size, std::ios_base::cur);
 
       if (print_log) {
         std::printf("[ANNS-DS %s]: Dataset dimension = %zu\n", __func__,
@@ -356,108 +1928,749 @@ int load(MEM_T *const ptr, std::ifstream &ifs, const bool print_log = false,
         std::fflush(stdout);
       }
 
-      // Load
-      for (HEADER_T i = 0; i < num_load_vecs; i++) {
-        HEADER_T tmp;
-        ifs.read(reinterpret_cast<char *>(&tmp), sizeof(HEADER_T));
+      // Load multiple vectors at once. When MEM_T != T, the block is
+      // converted after loading it into the staging buffer.
+      const auto block_size = std::min<std::size_t>(
+          num_load_vecs,
+          std::max<std::size_t>(1, detail::load_block_bytes /
+                                       std::max<std::size_t>(1, row_size)));
+      std::unique_ptr<char[]> buffer;
+      if (!direct_read) {
+        buffer = std::unique_ptr<char[]>(new char[block_size * row_size]);
+      }
+      detail::io_monitor monitor(observer, num_load_vecs, print_log, __func__,
+                                 "Loading");
+      for (std::size_t i = 0; i < num_load_vecs; i += block_size) {
+        const auto num_rows = std::min(block_size, num_load_vecs - i);
+        const auto dst = ptr + static_cast<std::uint64_t>(i) * dst_ld;
+        const auto t0 = monitor.get_time();
+        auto t1 = t0;
+        if (direct_read) {
+          ifs.read(reinterpret_cast<char *>(dst), num_rows * row_size);
+          t1 = monitor.get_time();
+        } else {
+          ifs.read(buffer.get(), num_rows * row_size);
+          t1 = monitor.get_time();
+          detail::copy_rows<MEM_T, T>(dst, dst_ld, buffer.get(), row_size,
+                                      num_rows, data_dim);
+          detail::fill_padding(dst, dst_ld, num_rows, data_dim,
+                               padding_value);
+        }
+        if (!ifs) {
+          std::fprintf(stderr, "[ANNS-DS %s]: Failed to read the dataset\n",
+                       __func__);
+          return 1;
+        }
+        monitor.add_read(num_rows * row_size, num_rows, t0, t1);
+      }
+      monitor.complete();
+    }
+    if (print_log) {
+      std::printf("[ANNS-DS %s]: Completed\n", __func__);
+      std::fflush(stdout);
+    }
+  }
+  return 0;
+}
+
+template <class MEM_T, class T = MEM_T, class HEADER_T = void>
+int load(MEM_T *const ptr, const std::string file_path,
+         const bool print_log = false,
+         const format_t format = format_t::FORMAT_AUTO_DETECT,
+         const range_t range = range_t{.offset = 0, .size = 0},
+         const bool check_vecs_header = false, const std::size_t ldd = 0,
+         const MEM_T padding_value = MEM_T(0),
+         const projection_t &projection = projection_t{},
+         io_observer *const observer = nullptr) {
+  // SQ8 datasets are dequantized when loaded as float
+  if constexpr (std::is_same<MEM_T, float>::value &&
+                std::is_same<T, float>::value) {
+    const auto res = detail::load_sq8(ptr, file_path, 1, print_log, format,
+                                      range, ldd, padding_value, projection,
+                                      check_vecs_header, observer);
+    if (res >= 0) {
+      return res;
+    }
+  }
+
+  std::ifstream ifs(file_path);
+  if (!ifs) {
+    std::fprintf(stderr, "No such file : %s\n", file_path.c_str());
+    return 1;
+  }
+
+  // Skip the format detection if the sidecar metadata is valid
+  layout_t layout;
+  if (std::is_same<HEADER_T, void>::value &&
+      load_metadata<T>(file_path, layout, format)) {
+    const auto f = layout.format & format_t::FORMAT_MASK;
+    const auto res =
+        (layout.format & format_t::HEADER_MASK) == format_t::HEADER_U64
+            ? load<MEM_T, T, std::uint64_t>(ptr, ifs, print_log, f, range,
+                                             check_vecs_header, ldd,
+                                             padding_value, projection,
+                                             observer)
+            : load<MEM_T, T, std::uint32_t>(ptr, ifs, print_log, f, range,
+                                             check_vecs_header, ldd,
+                                             padding_value, projection,
+                                             observer);
+    ifs.close();
+    return res;
+  }
+
+  const auto res =
+      load<MEM_T, T, HEADER_T>(ptr, ifs, print_log, format, range,
+                               check_vecs_header, ldd, padding_value,
+                               projection, observer);
+
+  ifs.close();
+  return res;
+}
+
+namespace detail {
+// Read `range` of the dataset `fd` described by `layout` into `ptr` with
+// `num_threads` threads. Throws on failure.
+template <class MEM_T, class T>
+void load_parallel_core(MEM_T *const ptr, const int fd, const layout_t &layout,
+                        const unsigned num_threads, const range_t range,
+                        const bool check_vecs_header, const std::size_t ldd,
+                        const MEM_T padding_value, const bool print_log,
+                        io_observer *const observer = nullptr) {
+  const auto dst_ld = ldd == 0 ? layout.data_dim : ldd;
+  if (!range.is_valid(layout.num_data)) {
+    throw std::runtime_error("Out of range");
+  }
+  const auto num_load_vecs = range.get_size(layout.num_data);
+
+  const auto chunk_size = std::max<std::size_t>(
+      1,
+      parallel_load_chunk_bytes / std::max<std::size_t>(1, layout.row_stride));
+  if (print_log) {
+    std::printf("[ANNS-DS load]: Num load data = %zu, offset = %zu, "
+                "num threads = %u\n",
+                num_load_vecs, range.offset, get_num_threads(num_threads));
+    std::fflush(stdout);
+  }
+
+  io_monitor monitor(observer, num_load_vecs, print_log, "load", "Loading");
+  parallel_for_chunks(num_load_vecs, chunk_size, num_threads,
+                      [&](const std::size_t begin, const std::size_t end) {
+                        std::vector<char> staging;
+                        read_rows<MEM_T, T>(fd, layout, range.offset + begin,
+                                            end - begin, ptr + begin * dst_ld,
+                                            dst_ld, staging, check_vecs_header,
+                                            padding_value, &monitor);
+                      });
+  monitor.complete();
+}
+} // namespace detail
+
+// Load a dataset with `num_threads` threads (0: hardware concurrency) using
+// positional reads
+template <class MEM_T, class T = MEM_T, class HEADER_T = void>
+int load_parallel(MEM_T *const ptr, const std::string file_path,
+                  const unsigned num_threads = 0, const bool print_log = false,
+                  const format_t format = format_t::FORMAT_AUTO_DETECT,
+                  const range_t range = range_t{.offset = 0, .size = 0},
+                  const bool check_vecs_header = false,
+                  const std::size_t ldd = 0,
+                  const MEM_T padding_value = MEM_T(0),
+                  io_observer *const observer = nullptr) {
+  if constexpr (std::is_same<MEM_T, float>::value &&
+                std::is_same<T, float>::value) {
+    const auto res =
+        detail::load_sq8(ptr, file_path, num_threads, print_log, format, range,
+                         ldd, padding_value, projection_t{}, check_vecs_header,
+                         observer);
+    if (res >= 0) {
+      return res;
+    }
+  }
+
+  layout_t layout;
+  try {
+    layout = load_layout<T, HEADER_T>(file_path, format, print_log);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                 file_path.c_str());
+    return 1;
+  }
+
+  const int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::fprintf(stderr, "No such file : %s\n", file_path.c_str());
+    return 1;
+  }
+
+  int res = 0;
+  try {
+    detail::load_parallel_core<MEM_T, T>(ptr, fd, layout, num_threads, range,
+                                         check_vecs_header, ldd, padding_value,
+                                         print_log, observer);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                 file_path.c_str());
+    res = 1;
+  }
+  ::close(fd);
+
+  if (print_log && res == 0) {
+    std::printf("[ANNS-DS %s]: Completed\n", __func__);
+    std::fflush(stdout);
+  }
+  return res;
+}
+
+namespace detail {
+// Vectors whose distance is less than this are read in one call
+constexpr std::size_t gather_max_gap_bytes = 64lu << 10;
+constexpr std::size_t gather_max_read_bytes = 16lu << 20;
+
+// Gather the vectors `ids` of the dataset `fd` described by `layout`.
+// Throws on failure.
+template <class MEM_T, class T, class INDEX_T>
+void load_rows_core(MEM_T *const ptr, const int fd, const layout_t &layout,
+                    const INDEX_T *const ids, const std::size_t num_ids,
+                    const unsigned num_threads, const std::size_t ldd,
+                    const MEM_T padding_value, const bool print_log) {
+  // Sort the ids while keeping their positions in `ptr`
+  std::vector<std::size_t> order(num_ids);
+  for (std::size_t i = 0; i < num_ids; i++) {
+    order[i] = i;
+    if (static_cast<std::size_t>(ids[i]) >= layout.num_data) {
+      throw std::runtime_error(
+          "Index " + std::to_string(static_cast<std::size_t>(ids[i])) +
+          " is out of range");
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](const auto a, const auto b) {
+    return ids[a] < ids[b];
+  });
+
+  // Coalesce nearby vectors. groups[g] = [begin, end) of `order`
+  std::vector<std::pair<std::size_t, std::size_t>> groups;
+  for (std::size_t i = 0; i < num_ids;) {
+    const std::size_t first_id = ids[order[i]];
+    std::size_t j = i + 1;
+    for (; j < num_ids; j++) {
+      const std::size_t prev_id = ids[order[j - 1]];
+      const std::size_t id = ids[order[j]];
+      if ((id - prev_id) * layout.row_stride > gather_max_gap_bytes ||
+          (id - first_id + 1) * layout.row_stride > gather_max_read_bytes) {
+        break;
+      }
+    }
+    groups.push_back(std::make_pair(i, j));
+    i = j;
+  }
+
+  if (print_log) {
+    std::printf("[ANNS-DS load_rows]: Num load data = %zu, num reads = %zu\n",
+                num_ids, groups.size());
+    std::fflush(stdout);
+  }
+
+  const auto data_dim = layout.data_dim;
+  const auto dst_ld = ldd == 0 ? data_dim : ldd;
+  const bool is_vecs =
+      (layout.format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN;
+  const std::size_t header_bytes = is_vecs ? layout.data_offset : 0;
+
+  parallel_for_chunks(
+      groups.size(), 1, num_threads,
+      [&](const std::size_t g, const std::size_t) {
+        const auto [begin, end] = groups[g];
+        const std::size_t first_id = ids[order[begin]];
+        const std::size_t last_id = ids[order[end - 1]];
+        const auto read_bytes = (last_id - first_id + 1) * layout.row_stride;
+
+        std::vector<char> staging(read_bytes);
+        pread_all(fd, staging.data(), read_bytes,
+                  layout.row_offset(first_id) - header_bytes);
+        // Scatter the vectors into the caller's order
+        for (std::size_t k = begin; k < end; k++) {
+          const std::size_t id = ids[order[k]];
+          const auto dst = ptr + order[k] * dst_ld;
+          copy_rows<MEM_T, T>(dst, dst_ld,
+                              staging.data() +
+                                  (id - first_id) * layout.row_stride +
+                                  header_bytes,
+                              layout.row_stride, 1, data_dim);
+          fill_padding(dst, dst_ld, 1, data_dim, padding_value);
+        }
+      });
+}
+} // namespace detail
+
+// Load the vectors `ids[0], ..., ids[num_ids - 1]` into `ptr` in the given
+// order. Nearby vectors are coalesced into one read and the reads are issued
+// by `num_threads` threads (0: hardware concurrency).
+template <class MEM_T, class T = MEM_T, class HEADER_T = void, class INDEX_T>
+int load_rows(MEM_T *const ptr, const std::string file_path,
+              const INDEX_T *const ids, const std::size_t num_ids,
+              const unsigned num_threads = 0, const bool print_log = false,
+              const format_t format = format_t::FORMAT_AUTO_DETECT,
+              const std::size_t ldd = 0,
+              const MEM_T padding_value = MEM_T(0)) {
+  layout_t layout;
+  try {
+    layout = load_layout<T, HEADER_T>(file_path, format, print_log);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                 file_path.c_str());
+    return 1;
+  }
+
+  const int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::fprintf(stderr, "No such file : %s\n", file_path.c_str());
+    return 1;
+  }
+
+  int res = 0;
+  try {
+    detail::load_rows_core<MEM_T, T>(ptr, fd, layout, ids, num_ids,
+                                     num_threads, ldd, padding_value,
+                                     print_log);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                 file_path.c_str());
+    res = 1;
+  }
+  ::close(fd);
+
+  if (print_log && res == 0) {
+    std::printf("[ANNS-DS %s]: Completed\n", __func__);
+    std::fflush(stdout);
+  }
+  return res;
+}
+
+// Read a dataset batch by batch. The next batch is prefetched by a background
+// thread into a double buffer while the current one is being processed.
+template <class MEM_T, class T = MEM_T> class load_stream {
+public:
+  struct batch_t {
+    const MEM_T *data = nullptr;
+    // Index of the first vector of this batch in the dataset file
+    std::size_t offset = 0;
+    std::size_t size = 0;
+  };
+
+  class iterator {
+    load_stream *stream;
+    batch_t batch;
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = batch_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const batch_t *;
+    using reference = const batch_t &;
+
+    inline iterator(load_stream *const stream) : stream(stream) {
+      if (stream != nullptr && !stream->next(batch)) {
+        this->stream = nullptr;
+      }
+    }
+    inline reference operator*() const { return batch; }
+    inline pointer operator->() const { return &batch; }
+    inline iterator &operator++() {
+      if (!stream->next(batch)) {
+        stream = nullptr;
+      }
+      return *this;
+    }
+    inline bool operator==(const iterator &o) const {
+      return stream == o.stream;
+    }
+    inline bool operator!=(const iterator &o) const { return !(*this == o); }
+  };
+
+private:
+  enum class slot_state_t { free, ready, in_use };
+
+  layout_t layout;
+  int fd = -1;
+  const std::size_t batch_size;
+  std::size_t range_offset;
+  std::size_t dst_ld;
+  const MEM_T padding_value;
+  std::size_t num_load_vecs;
+  std::size_t num_batches;
+  const bool print_log;
+
+  std::unique_ptr<MEM_T[]> buffers[2];
+  slot_state_t slot_state[2] = {slot_state_t::free, slot_state_t::free};
+  std::size_t next_batch = 0;
+  int held_slot = -1;
+  bool stop = false;
+  std::exception_ptr error;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::thread worker;
+  std::unique_ptr<detail::io_monitor> monitor;
+
+  inline std::size_t get_batch_size(const std::size_t b) const {
+    return std::min(batch_size, num_load_vecs - b * batch_size);
+  }
+
+  // Allocate the buffers and launch the prefetch thread
+  inline void start(const range_t range, const std::size_t ldd,
+                    io_observer *const observer) {
+    dst_ld = ldd == 0 ? layout.data_dim : ldd;
+    if (!range.is_valid(layout.num_data)) {
+      ::close(fd);
+      throw std::runtime_error("[ANNS-DS load_stream]: Out of range");
+    }
+    num_load_vecs = range.get_size(layout.num_data);
+    num_batches = (num_load_vecs + batch_size - 1) / batch_size;
+
+    for (auto &buffer : buffers) {
+      buffer = std::unique_ptr<MEM_T[]>(
+          new MEM_T[std::min(batch_size, num_load_vecs) * dst_ld]);
+    }
+
+    if (print_log) {
+      std::printf("[ANNS-DS load_stream]: Num load data = %zu, offset = %zu, "
+                  "batch size = %zu\n",
+                  num_load_vecs, range_offset, batch_size);
+      std::fflush(stdout);
+    }
+
+    monitor = std::make_unique<detail::io_monitor>(observer, num_load_vecs,
+                                                   false);
+    worker = std::thread([this]() { prefetch(); });
+  }
+
+  inline void prefetch() {
+    std::vector<char> staging;
+    for (std::size_t b = 0; b < num_batches; b++) {
+      const auto slot = b % 2;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock,
+                [&] { return stop || slot_state[slot] == slot_state_t::free; });
+        if (stop) {
+          return;
+        }
+      }
+      try {
+        detail::read_rows<MEM_T, T>(fd, layout, range_offset + b * batch_size,
+                                    get_batch_size(b), buffers[slot].get(),
+                                    dst_ld, staging, false, padding_value,
+                                    monitor.get());
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mtx);
+        error = std::current_exception();
+        cv.notify_all();
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        slot_state[slot] = slot_state_t::ready;
+      }
+      cv.notify_all();
+    }
+    monitor->complete();
+  }
+
+public:
+  inline load_stream(const std::string file_path, const std::size_t batch_size,
+                     const format_t format = format_t::FORMAT_AUTO_DETECT,
+                     const range_t range = range_t{.offset = 0, .size = 0},
+                     const bool print_log = false, const std::size_t ldd = 0,
+                     const MEM_T padding_value = MEM_T(0),
+                     io_observer *const observer = nullptr)
+      : batch_size(std::max<std::size_t>(1, batch_size)),
+        range_offset(range.offset), padding_value(padding_value),
+        print_log(print_log) {
+    layout = load_layout<T>(file_path, format, print_log);
+    fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("No such file: " + file_path);
+    }
+    if (print_log) {
+      std::printf("[ANNS-DS load_stream]: Dataset path = %s\n",
+                  file_path.c_str());
+      std::fflush(stdout);
+    }
+    start(range, ldd, observer);
+  }
+
+  // Stream from an already opened file whose layout is known.
+  // `fd` is duplicated and can be closed by the caller.
+  inline load_stream(const int fd, const layout_t &layout,
+                     const std::size_t batch_size,
+                     const range_t range = range_t{.offset = 0, .size = 0},
+                     const bool print_log = false, const std::size_t ldd = 0,
+                     const MEM_T padding_value = MEM_T(0),
+                     io_observer *const observer = nullptr)
+      : layout(layout), batch_size(std::max<std::size_t>(1, batch_size)),
+        range_offset(range.offset), padding_value(padding_value),
+        print_log(print_log) {
+    this->fd = ::dup(fd);
+    if (this->fd < 0) {
+      throw std::runtime_error(
+          "[ANNS-DS load_stream]: Invalid file descriptor");
+    }
+    start(range, ldd, observer);
+  }
+
+  load_stream(const load_stream &) = delete;
+  load_stream &operator=(const load_stream &) = delete;
+
+  inline ~load_stream() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+      worker.join();
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  // Get the next batch. The previous batch is released by this call.
+  // Returns false when all batches have been read.
+  inline bool next(batch_t &batch) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (held_slot >= 0) {
+      slot_state[held_slot] = slot_state_t::free;
+      held_slot = -1;
+      cv.notify_all();
+    }
+    if (next_batch >= num_batches) {
+      return false;
+    }
+
+    const auto slot = next_batch % 2;
+    cv.wait(lock,
+            [&] { return error || slot_state[slot] == slot_state_t::ready; });
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    slot_state[slot] = slot_state_t::in_use;
+    held_slot = static_cast<int>(slot);
+
+    batch.data = buffers[slot].get();
+    batch.offset = range_offset + next_batch * batch_size;
+    batch.size = get_batch_size(next_batch);
+    next_batch++;
+    return true;
+  }
+
+  inline iterator begin() { return iterator(this); }
+  inline iterator end() { return iterator(nullptr); }
+
+  // The number of vectors to be read by this stream
+  inline std::size_t size() const { return num_load_vecs; }
+  inline std::size_t dim() const { return layout.data_dim; }
+  // Leading dimension of the batches
+  inline std::size_t ld() const { return dst_ld; }
+  inline std::size_t get_num_batches() const { return num_batches; }
+  inline const layout_t &get_layout() const { return layout; }
+};
+
+namespace detail {
+template <class T, class HEADER_T>
+inline format_t detect_file_format(const HEADER_T header[2],
+                                   const std::size_t file_size) {
+  if (is_bigann<T, HEADER_T>(header, file_size)) {
+    return format_t::FORMAT_BIGANN | get_header_t<HEADER_T>();
+  } else if (is_vecs<T, HEADER_T>(header, file_size)) {
+    return format_t::FORMAT_VECS | get_header_t<HEADER_T>();
+  }
+  return format_t::FORMAT_UNKNOWN;
+}
+
+// Same as `load_layout` but reads the header from an opened file
+template <class T>
+inline layout_t load_layout(const int fd, const format_t format) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw std::runtime_error("Failed to stat the file");
+  }
+  const std::size_t file_size = st.st_size;
+
+  // Enough for both U32 and U64 headers
+  std::uint64_t header[2] = {0, 0};
+  if (file_size < sizeof(std::uint32_t) * 2) {
+    throw std::runtime_error("Could not detect the file format");
+  }
+  pread_all(fd, header, std::min(sizeof(header), file_size), 0);
+  const auto header_u32 = reinterpret_cast<const std::uint32_t *>(header);
+
+  auto header_type = format & format_t::HEADER_MASK;
+  auto format_type = format & format_t::FORMAT_MASK;
+  if (header_type == format_t::FORMAT_UNKNOWN ||
+      format_type == format_t::FORMAT_AUTO_DETECT ||
+      format_type == format_t::FORMAT_UNKNOWN) {
+    auto detected_format = format_t::FORMAT_UNKNOWN;
+    if (header_type != format_t::HEADER_U64) {
+      detected_format = detect_file_format<T>(header_u32, file_size);
+    }
+    if (detected_format == format_t::FORMAT_UNKNOWN &&
+        header_type != format_t::HEADER_U32 &&
+        file_size >= sizeof(header)) {
+      detected_format = detect_file_format<T>(header, file_size);
+    }
+    if (detected_format == format_t::FORMAT_UNKNOWN) {
+      throw std::runtime_error("Could not detect the file format");
+    }
+    header_type = detected_format & format_t::HEADER_MASK;
+    if (format_type == format_t::FORMAT_AUTO_DETECT ||
+        format_type == format_t::FORMAT_UNKNOWN) {
+      format_type = detected_format & format_t::FORMAT_MASK;
+    }
+  }
+
+  if (header_type == format_t::HEADER_U64) {
+    return make_layout<T, std::uint64_t>(format_type, header, file_size);
+  }
+  return make_layout<T, std::uint32_t>(format_type, header_u32, file_size);
+}
+} // namespace detail
 
-        const auto offset = static_cast<std::uint64_t>(i) * data_dim;
-        if constexpr (std::is_same<T, MEM_T>::value) {
-          ifs.read(reinterpret_cast<char *>(ptr + offset),
-                   sizeof(T) * data_dim);
-        } else {
-          ifs.read(reinterpret_cast<char *>(buffer.get()),
-                   sizeof(T) * data_dim);
-          for (std::uint32_t j = 0; j < data_dim; j++) {
-            (ptr + offset)[j] = static_cast<MEM_T>(buffer.get()[j]);
-          }
-        }
+// A dataset file which is opened and probed once. The file descriptor and the
+// layout are kept and shared by all loads through this handle.
+template <class T> class dataset_file {
+  std::string file_path;
+  int fd = -1;
+  layout_t layout;
+  bool print_log;
 
-        if (print_log) {
-          if (num_load_vecs > loading_progress_interval &&
-              i % (num_load_vecs / loading_progress_interval) == 0) {
-            std::printf("[ANNS-DS %s]: Loading... (%4.2f %%)\r", __func__,
-                        i * 100. / num_load_vecs);
-            std::fflush(stdout);
-          }
-        }
-      }
-      if (print_log && num_load_vecs > loading_progress_interval) {
-        std::printf("\n");
+public:
+  inline dataset_file(const std::string file_path,
+                      const format_t format = format_t::FORMAT_AUTO_DETECT,
+                      const bool print_log = false)
+      : file_path(file_path), print_log(print_log) {
+    fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("No such file: " + file_path);
+    }
+    try {
+      detail::check_not_sq8<T>(file_path);
+      if (!load_metadata<T>(file_path, layout, format)) {
+        layout = detail::load_layout<T>(fd, format);
       }
-    } else {
-      const std::size_t data_dim = header[1];
-      const std::size_t num_data = header[0];
+    } catch (const std::exception &e) {
+      ::close(fd);
+      throw std::runtime_error(std::string(e.what()) + " (" + file_path + ")");
+    }
 
-      std::unique_ptr<T[]> buffer;
-      if constexpr (!std::is_same<T, MEM_T>::value) {
-        buffer = std::unique_ptr<T[]>(new T[data_dim]);
-      }
+    if (print_log) {
+      std::printf("[ANNS-DS dataset_file]: Dataset path = %s\n",
+                  file_path.c_str());
+      std::printf("[ANNS-DS dataset_file]: Format = %s, num data = %zu, "
+                  "dim = %zu\n",
+                  get_format_str(layout.format).c_str(), layout.num_data,
+                  layout.data_dim);
+      std::fflush(stdout);
+    }
+  }
 
-      // Set load offset
-      const auto num_load_vecs = range.size == 0 ? num_data : range.size;
-      ifs.seekg(range.offset * data_dim * sizeof(T), std::ios_base::cur);
-      assert(num_load_vecs + range.offset <= num_data);
+  dataset_file(const dataset_file &) = delete;
+  dataset_file &operator=(const dataset_file &) = delete;
 
-      if (print_log) {
-        std::printf("[ANNS-DS %s]: Dataset dimension = %zu\n", __func__,
-                    data_dim);
-        std::printf("[ANNS-DS %s]: Num data = %zu\n", __func__, num_data);
-        std::printf("[ANNS-DS %s]: Num load data = %zu, offset = %zu\n",
-                    __func__, num_load_vecs, range.offset);
-        std::fflush(stdout);
-      }
+  inline dataset_file(dataset_file &&o)
+      : file_path(std::move(o.file_path)), fd(o.fd), layout(o.layout),
+        print_log(o.print_log) {
+    o.fd = -1;
+  }
 
-      // Load
-      for (HEADER_T i = 0; i < num_load_vecs; i++) {
-        const auto offset = static_cast<std::uint64_t>(i) * data_dim;
-        if constexpr (std::is_same<T, MEM_T>::value) {
-          ifs.read(reinterpret_cast<char *>(ptr + offset),
-                   sizeof(T) * data_dim);
-        } else {
-          ifs.read(reinterpret_cast<char *>(buffer.get()),
-                   sizeof(T) * data_dim);
-          for (std::uint32_t j = 0; j < data_dim; j++) {
-            (ptr + offset)[j] = static_cast<MEM_T>(buffer.get()[j]);
-          }
-        }
-        if (print_log) {
-          if (num_load_vecs > loading_progress_interval &&
-              i % (num_load_vecs / loading_progress_interval) == 0) {
-            std::printf("[ANNS-DS %s]: Loading... (%4.2f %%)\r", __func__,
-                        i * 100. / num_load_vecs);
-            std::fflush(stdout);
-          }
-        }
-      }
-      if (print_log && num_load_vecs > loading_progress_interval) {
-        std::printf("\n");
-      }
+  inline ~dataset_file() {
+    if (fd >= 0) {
+      ::close(fd);
     }
-    if (print_log) {
-      std::printf("[ANNS-DS %s]: Completed\n", __func__);
-      std::fflush(stdout);
+  }
+
+  inline std::size_t size() const { return layout.num_data; }
+  inline std::size_t dim() const { return layout.data_dim; }
+  inline format_t format() const { return layout.format; }
+  inline std::size_t file_size() const { return layout.file_size; }
+  inline const layout_t &get_layout() const { return layout; }
+  inline const std::string &path() const { return file_path; }
+
+  // Load `range` of the dataset with `num_threads` threads (0: hardware
+  // concurrency)
+  template <class MEM_T = T>
+  inline int load_range(MEM_T *const ptr, const range_t range,
+                        const unsigned num_threads = 1,
+                        const std::size_t ldd = 0,
+                        const MEM_T padding_value = MEM_T(0),
+                        const bool check_vecs_header = false,
+                        io_observer *const observer = nullptr) const {
+    try {
+      detail::load_parallel_core<MEM_T, T>(ptr, fd, layout, num_threads, range,
+                                           check_vecs_header, ldd,
+                                           padding_value, print_log, observer);
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                   file_path.c_str());
+      return 1;
     }
+    return 0;
   }
-  return 0;
-}
 
-template <class MEM_T, class T = MEM_T, class HEADER_T = void>
-int load(MEM_T *const ptr, const std::string file_path,
-         const bool print_log = false,
-         const format_t format = format_t::FORMAT_AUTO_DETECT,
-         const range_t range = range_t{.offset = 0, .size = 0}) {
-  std::ifstream ifs(file_path);
-  if (!ifs) {
-    std::fprintf(stderr, "No such file : %s\n", file_path.c_str());
-    return 1;
+  template <class MEM_T = T>
+  inline int load(MEM_T *const ptr, const unsigned num_threads = 1,
+                  const std::size_t ldd = 0,
+                  const MEM_T padding_value = MEM_T(0),
+                  const bool check_vecs_header = false,
+                  io_observer *const observer = nullptr) const {
+    return load_range(ptr, range_t{.offset = 0, .size = 0}, num_threads, ldd,
+                      padding_value, check_vecs_header, observer);
   }
 
-  const auto res = load(ptr, ifs, print_log, format, range);
+  template <class MEM_T = T, class INDEX_T>
+  inline int load_rows(MEM_T *const ptr, const INDEX_T *const ids,
+                       const std::size_t num_ids,
+                       const unsigned num_threads = 0,
+                       const std::size_t ldd = 0,
+                       const MEM_T padding_value = MEM_T(0)) const {
+    try {
+      detail::load_rows_core<MEM_T, T>(ptr, fd, layout, ids, num_ids,
+                                       num_threads, ldd, padding_value,
+                                       print_log);
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                   file_path.c_str());
+      return 1;
+    }
+    return 0;
+  }
 
-  ifs.close();
-  return res;
+  template <class MEM_T = T>
+  inline std::unique_ptr<load_stream<MEM_T, T>>
+  stream(const std::size_t batch_size,
+         const range_t range = range_t{.offset = 0, .size = 0},
+         const std::size_t ldd = 0,
+         const MEM_T padding_value = MEM_T(0),
+         io_observer *const observer = nullptr) const {
+    return std::make_unique<load_stream<MEM_T, T>>(
+        fd, layout, batch_size, range, print_log, ldd, padding_value,
+        observer);
+  }
+};
+
+namespace detail {
+// Throws when the number of vectors or the dimension does not fit a 32-bit
+// header
+inline void check_u32_header(const std::size_t num_data,
+                             const std::size_t data_dim) {
+  const std::size_t max = std::numeric_limits<std::uint32_t>::max();
+  if (num_data > max || data_dim > max) {
+    throw std::runtime_error("[ANNS-DS store]: The dataset (size = " +
+                             std::to_string(num_data) +
+                             ", dim = " + std::to_string(data_dim) +
+                             ") does not fit the 32-bit header");
+  }
 }
+} // namespace detail
 
 template <class T> class store_stream {
   const std::size_t dataset_dim;
@@ -469,11 +2682,33 @@ template <class T> class store_stream {
   std::size_t current_dataset_size_ = 0;
   std::ios::pos_type beg_pos;
 
+  // Vectors are assembled in this buffer and written in large blocks
+  std::vector<char> buffer;
+  std::size_t buffer_used = 0;
+  bool closed = false;
+
+  // Write the sidecar metadata of `dst_path` on close
+  const std::string dst_path;
+  const bool write_metadata = false;
+
+  detail::io_monitor monitor;
+
 public:
+  static constexpr std::size_t default_buffer_size = 64lu << 20;
+
   inline store_stream(const std::string dst_path, const std::size_t data_dim,
-                      const format_t format, const bool print_log = false)
-      : dataset_dim(data_dim), format(format), print_log(print_log) {
+                      const format_t format, const bool print_log = false,
+                      const std::size_t buffer_size = default_buffer_size,
+                      const bool write_metadata = false,
+                      io_observer *const observer = nullptr)
+      : dataset_dim(data_dim), format(format), print_log(print_log),
+        buffer(std::max<std::size_t>(1, buffer_size)), dst_path(dst_path),
+        write_metadata(write_metadata),
+        monitor(observer, 0, print_log, "store", "Storing") {
     ofs.open(dst_path, std::ios::binary);
+    if (!ofs) {
+      throw std::runtime_error("[ANNS-DS store]: Failed to open " + dst_path);
+    }
     ofs_ref = &ofs;
     beg_pos = ofs.tellp();
 
@@ -496,12 +2731,17 @@ public:
       std::printf("[ANNS-DS store]: Dataset dimension = %zu\n", data_dim);
       std::fflush(stdout);
     }
+    write_header();
   }
 
   inline store_stream(std::ofstream &ofs_ref, const std::size_t data_dim,
-                      const format_t format, const bool print_log = false)
+                      const format_t format, const bool print_log = false,
+                      const std::size_t buffer_size = default_buffer_size,
+                      io_observer *const observer = nullptr)
       : dataset_dim(data_dim), format(format), print_log(print_log),
-        ofs_ref(&ofs_ref), beg_pos(ofs_ref.tellp()) {
+        ofs_ref(&ofs_ref), beg_pos(ofs_ref.tellp()),
+        buffer(std::max<std::size_t>(1, buffer_size)),
+        monitor(observer, 0, print_log, "store", "Storing") {
 
     const auto format_t = format & format_t::FORMAT_MASK;
     const auto header_t = format & format_t::HEADER_MASK;
@@ -521,14 +2761,100 @@ public:
       std::printf("[ANNS-DS store]: Write to ofstream\n");
       std::fflush(stdout);
     }
+    write_header();
+  }
+
+  store_stream(const store_stream &) = delete;
+  store_stream &operator=(const store_stream &) = delete;
+
+  inline ~store_stream() {
+    if (!closed) {
+      try {
+        flush();
+      } catch (...) {
+      }
+    }
   }
 
 private:
+  inline bool is_vecs() const {
+    return (format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN;
+  }
+
+  inline void write_data(const void *const ptr, const std::size_t size) {
+    const auto t0 = monitor.get_time();
+    ofs_ref->write(static_cast<const char *>(ptr), size);
+    if (!*ofs_ref) {
+      throw std::runtime_error("[ANNS-DS store]: Failed to write " +
+                               std::to_string(size) + " bytes");
+    }
+    if (monitor.enabled()) {
+      io_metrics_t block;
+      block.bytes_written = size;
+      block.num_write_calls = 1;
+      block.io_time =
+          detail::io_monitor::seconds(t0, detail::io_monitor::now());
+      monitor.add(block);
+    }
+  }
+
+  // `num_rows` vectors have been copied or converted since `t0`
+  inline void add_rows(const std::size_t num_rows,
+                       const detail::io_monitor::time_point t0) {
+    if (monitor.enabled()) {
+      io_metrics_t block;
+      block.num_done = num_rows;
+      block.convert_time =
+          detail::io_monitor::seconds(t0, detail::io_monitor::now());
+      monitor.add(block);
+    }
+  }
+
+  // Write the BIGANN header at the beginning of the dataset. The dimension
+  // is also checked for the per-vector header of FORMAT_VECS.
+  inline void write_header() {
+    const bool u64_header =
+        (format & format_t::HEADER_MASK) == format_t::HEADER_U64;
+    if (!u64_header) {
+      detail::check_u32_header(is_vecs() ? 0 : current_dataset_size_,
+                               dataset_dim);
+    }
+    if (is_vecs()) {
+      return;
+    }
+    const auto current_pos = ofs_ref->tellp();
+    ofs_ref->seekp(beg_pos, std::ios::beg);
+    if (u64_header) {
+      const std::uint64_t header[2] = {current_dataset_size_, dataset_dim};
+      write_data(header, sizeof(header));
+    } else {
+      const std::uint32_t header[2] = {
+          static_cast<std::uint32_t>(current_dataset_size_),
+          static_cast<std::uint32_t>(dataset_dim)};
+      write_data(header, sizeof(header));
+    }
+    if (current_pos > beg_pos) {
+      ofs_ref->seekp(current_pos);
+    }
+  }
+
+  inline void write_buffer() {
+    if (buffer_used != 0) {
+      write_data(buffer.data(), buffer_used);
+      buffer_used = 0;
+    }
+  }
+
+  inline void reserve_buffer(const std::size_t size) {
+    if (buffer_used + size > buffer.size()) {
+      write_buffer();
+    }
+  }
+
   template <class HEADER_T>
   inline void _append_core(const T *const dataset_ptr, const std::size_t ldd,
                            const std::size_t append_size) {
     current_dataset_size_ += append_size;
-    const HEADER_T current_dataset_size = current_dataset_size_;
 
     if (print_log) {
       std::printf(
@@ -537,52 +2863,43 @@ private:
       std::fflush(stdout);
     }
 
-    constexpr auto loading_progress_interval = 1000;
-    if ((format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN) {
-      for (std::size_t i = 0; i < append_size; i++) {
-        const HEADER_T d = dataset_dim;
-        ofs_ref->write(reinterpret_cast<const char *>(&d), sizeof(HEADER_T));
-        ofs_ref->write(reinterpret_cast<const char *>(dataset_ptr + i * ldd),
-                       sizeof(T) * dataset_dim);
-
-        if (print_log) {
-          if (append_size > loading_progress_interval &&
-              i % (append_size / loading_progress_interval) == 0) {
-            std::printf("[ANNS-DS store]: Storing... (%4.2f %%)\r",
-                        i * 100. / append_size);
-            std::fflush(stdout);
-          }
-        }
-      }
-    } else if ((format & format_t::FORMAT_BIGANN) != format_t::FORMAT_UNKNOWN) {
+    const std::size_t data_size = sizeof(T) * dataset_dim;
+    const std::size_t header_size = is_vecs() ? sizeof(HEADER_T) : 0;
+    const std::size_t row_size = header_size + data_size;
+
+    if (header_size == 0 && ldd == dataset_dim &&
+        append_size * data_size >= buffer.size()) {
+      // Large contiguous BIGANN data is written without copying
+      write_buffer();
+      write_data(dataset_ptr, append_size * data_size);
+      add_rows(append_size, monitor.get_time());
+    } else {
       const HEADER_T d = dataset_dim;
-      const HEADER_T s = current_dataset_size;
-      ofs_ref->seekp(beg_pos, std::ios::beg);
-      ofs_ref->write(reinterpret_cast<const char *>(&s), sizeof(HEADER_T));
-      ofs_ref->write(reinterpret_cast<const char *>(&d), sizeof(HEADER_T));
-
-      ofs_ref->seekp(0, ofs_ref->end);
-      for (std::size_t i = 0; i < append_size; i++) {
-        ofs_ref->write(reinterpret_cast<const char *>(dataset_ptr + i * ldd),
-                       sizeof(T) * dataset_dim);
-
-        if (print_log) {
-          if (append_size > loading_progress_interval &&
-              i % (append_size / loading_progress_interval) == 0) {
-            std::printf("[ANNS-DS store]: Storing... (%4.2f %%)\r",
-                        i * 100. / append_size);
-            std::fflush(stdout);
+      const auto block_size =
+          std::max<std::size_t>(1, buffer.size() / std::max<std::size_t>(
+                                                       1, row_size));
+      for (std::size_t i = 0; i < append_size; i += block_size) {
+        const auto num_rows = std::min(block_size, append_size - i);
+        if (row_size > buffer.size()) {
+          // A vector does not fit into the buffer
+          write_buffer();
+          write_data(&d, header_size);
+          write_data(dataset_ptr + i * ldd, data_size);
+          add_rows(num_rows, monitor.get_time());
+        } else {
+          reserve_buffer(num_rows * row_size);
+          const auto t0 = monitor.get_time();
+          for (std::size_t r = 0; r < num_rows; r++) {
+            const auto dst = buffer.data() + buffer_used;
+            std::memcpy(dst, &d, header_size);
+            std::memcpy(dst + header_size, dataset_ptr + (i + r) * ldd,
+                        data_size);
+            buffer_used += row_size;
           }
+          add_rows(num_rows, t0);
         }
       }
     }
-    if (print_log) {
-      if (append_size > loading_progress_interval) {
-        std::printf("\n");
-      }
-      std::printf("[ANNS-DS store]: Completed\n");
-      std::fflush(stdout);
-    }
   }
 
 public:
@@ -596,27 +2913,591 @@ public:
     }
   }
 
-  inline void close() { ofs.close(); }
+  // Append float vectors to a float16_t / bfloat16_t file. The vectors are
+  // converted (rounded to nearest) block by block. Other conversions would
+  // narrow silently and are not provided.
+  template <class SRC_T,
+            class = typename std::enable_if<
+                std::is_same<SRC_T, float>::value &&
+                (std::is_same<T, float16_t>::value ||
+                 std::is_same<T, bfloat16_t>::value)>::type>
+  inline void append(const SRC_T *const dataset_ptr, const std::size_t ldd,
+                     const std::size_t append_size) {
+    const auto block_size = std::max<std::size_t>(
+        1, buffer.size() / std::max<std::size_t>(1, dataset_dim * sizeof(T)));
+    std::vector<T> converted(std::min(block_size, append_size) * dataset_dim);
+    for (std::size_t i = 0; i < append_size; i += block_size) {
+      const auto num_rows = std::min(block_size, append_size - i);
+      const auto t0 = monitor.get_time();
+      for (std::size_t r = 0; r < num_rows; r++) {
+        detail::convert(converted.data() + r * dataset_dim,
+                        dataset_ptr + (i + r) * ldd, dataset_dim);
+      }
+      if (monitor.enabled()) {
+        io_metrics_t block;
+        block.convert_time =
+            detail::io_monitor::seconds(t0, detail::io_monitor::now());
+        monitor.add(block);
+      }
+      append(converted.data(), dataset_dim, num_rows);
+    }
+  }
+
+  // Write the buffered vectors and the BIGANN header to the file
+  inline void flush() {
+    write_buffer();
+    write_header();
+    ofs_ref->flush();
+    if (!*ofs_ref) {
+      throw std::runtime_error("[ANNS-DS store]: Failed to flush the dataset");
+    }
+  }
+
+  // Throws when the vectors could not be written (e.g. ENOSPC). The stream
+  // is closed either way.
+  inline void close() {
+    if (closed) {
+      return;
+    }
+    closed = true;
+    try {
+      flush();
+    } catch (...) {
+      ofs.close();
+      throw;
+    }
+    if (ofs_ref == &ofs) {
+      ofs.close();
+      if (!ofs) {
+        throw std::runtime_error("[ANNS-DS store]: Failed to close " +
+                                 dst_path);
+      }
+    }
+    monitor.complete();
+
+    if (write_metadata && ofs_ref == &ofs) {
+      store_metadata(dst_path, get_layout(), sizeof(T), get_type_str<T>(),
+                     print_log);
+    }
+  }
+
+  // The number of vectors appended so far
+  inline std::size_t size() const { return current_dataset_size_; }
+
+  // Layout of the vectors appended so far
+  inline layout_t get_layout() const {
+    if ((format & format_t::HEADER_MASK) == format_t::HEADER_U64) {
+      return get_layout_core<std::uint64_t>();
+    }
+    return get_layout_core<std::uint32_t>();
+  }
+
+private:
+  template <class HEADER_T> inline layout_t get_layout_core() const {
+    const HEADER_T header[2] = {
+        static_cast<HEADER_T>(is_vecs() ? dataset_dim : current_dataset_size_),
+        static_cast<HEADER_T>(dataset_dim)};
+    const auto row_stride =
+        (is_vecs() ? sizeof(HEADER_T) : 0) + dataset_dim * sizeof(T);
+    const auto file_size =
+        (is_vecs() ? 0 : 2 * sizeof(HEADER_T)) +
+        current_dataset_size_ * row_stride;
+    return detail::make_layout<T, HEADER_T>(format, header, file_size);
+  }
 };
 
-template <class T>
+// The element type in the file is `FILE_T` (e.g. float16_t) when given and
+// the type of `data_ptr` otherwise
+template <class FILE_T = void, class SRC_T>
 inline int store(const std::string dst_path, const std::size_t data_size,
-                 const std::size_t data_dim, const T *const data_ptr,
-                 const format_t format, const bool print_log = false) {
-  store_stream<T> ss(dst_path, data_dim, format, print_log);
+                 const std::size_t data_dim, const SRC_T *const data_ptr,
+                 const format_t format, const bool print_log = false,
+                 const bool write_metadata = false,
+                 io_observer *const observer = nullptr) {
+  using T = typename std::conditional<std::is_same<FILE_T, void>::value,
+                                      SRC_T, FILE_T>::type;
+  store_stream<T> ss(dst_path, data_dim, format, print_log,
+                     store_stream<T>::default_buffer_size, write_metadata,
+                     observer);
   ss.append(data_ptr, data_dim, data_size);
   ss.close();
 
   return 0;
 }
 
-template <class T>
+template <class FILE_T = void, class SRC_T>
 inline int store(std::ofstream &ofs, const std::size_t data_size,
-                 const std::size_t data_dim, const T *const data_ptr,
+                 const std::size_t data_dim, const SRC_T *const data_ptr,
                  const format_t format, const bool print_log = false) {
+  using T = typename std::conditional<std::is_same<FILE_T, void>::value,
+                                      SRC_T, FILE_T>::type;
   store_stream<T> ss(ofs, data_dim, format, print_log);
   ss.append(data_ptr, data_dim, data_size);
+  ss.close();
+
+  return 0;
+}
+
+enum class append_order_t {
+  // Vectors are placed in the order in which the ranges are reserved
+  unordered,
+  // Vectors are placed in the order of the sequence number given to append()
+  ordered,
+};
+
+// Thread-safe store stream. Each append() reserves an output range and writes
+// the vectors with positional writes, so producers do not wait for each other
+// while writing.
+template <class T> class concurrent_store_stream {
+  const std::size_t dataset_dim;
+  format_t format;
+  const append_order_t order;
+  const bool print_log;
+
+  int fd = -1;
+  std::size_t data_offset;
+  std::size_t header_size;
+  std::size_t row_size;
+
+  std::atomic<std::size_t> num_reserved;
+
+  // For append_order_t::ordered
+  std::size_t next_seq = 0;
+  std::mutex seq_mtx;
+  std::condition_variable seq_cv;
+
+  static constexpr std::size_t write_block_bytes = 16lu << 20;
+
+  inline std::size_t reserve(const std::size_t seq, const std::size_t size) {
+    if (order == append_order_t::unordered) {
+      return num_reserved.fetch_add(size);
+    }
+    std::unique_lock<std::mutex> lock(seq_mtx);
+    seq_cv.wait(lock, [&] { return next_seq == seq; });
+    const auto offset = num_reserved.fetch_add(size);
+    next_seq++;
+    lock.unlock();
+    seq_cv.notify_all();
+    return offset;
+  }
+
+  inline void write(const std::size_t offset, const T *const dataset_ptr,
+                    const std::size_t ldd, const std::size_t append_size) {
+    const std::size_t data_size = sizeof(T) * dataset_dim;
+    if (header_size == 0 && ldd == dataset_dim) {
+      detail::pwrite_all(fd, dataset_ptr, append_size * data_size,
+                         data_offset + offset * row_size);
+      return;
+    }
+
+    const auto block_size =
+        std::max<std::size_t>(1, write_block_bytes / row_size);
+    std::vector<char> buffer(std::min(block_size, append_size) * row_size);
+    for (std::size_t i = 0; i < append_size; i += block_size) {
+      const auto num_rows = std::min(block_size, append_size - i);
+      for (std::size_t r = 0; r < num_rows; r++) {
+        const auto dst = buffer.data() + r * row_size;
+        if (header_size == sizeof(std::uint64_t)) {
+          const std::uint64_t d = dataset_dim;
+          std::memcpy(dst, &d, header_size);
+        } else if (header_size == sizeof(std::uint32_t)) {
+          const std::uint32_t d = dataset_dim;
+          std::memcpy(dst, &d, header_size);
+        }
+        std::memcpy(dst + header_size, dataset_ptr + (i + r) * ldd, data_size);
+      }
+      detail::pwrite_all(fd, buffer.data(), num_rows * row_size,
+                         data_offset + (offset + i) * row_size);
+    }
+  }
+
+public:
+  inline concurrent_store_stream(
+      const std::string dst_path, const std::size_t data_dim,
+      const format_t format,
+      const append_order_t order = append_order_t::unordered,
+      const bool print_log = false)
+      : dataset_dim(data_dim), format(format), order(order),
+        print_log(print_log), num_reserved(0) {
+    if ((format & format_t::FORMAT_MASK) == format_t::FORMAT_UNKNOWN) {
+      throw std::runtime_error("[ANNS-DS store]: Unknown format (" +
+                               get_format_str(format) + ")");
+    }
+    if ((format & format_t::HEADER_MASK) == format_t::FORMAT_UNKNOWN) {
+      this->format = this->format | format_t::HEADER_U32;
+    }
+    const std::size_t header_t_size =
+        (this->format & format_t::HEADER_MASK) == format_t::HEADER_U64
+            ? sizeof(std::uint64_t)
+            : sizeof(std::uint32_t);
+    if ((this->format & format_t::FORMAT_VECS) != format_t::FORMAT_UNKNOWN) {
+      data_offset = 0;
+      header_size = header_t_size;
+    } else {
+      data_offset = 2 * header_t_size;
+      header_size = 0;
+    }
+    row_size = header_size + sizeof(T) * dataset_dim;
+    if (header_t_size == sizeof(std::uint32_t)) {
+      detail::check_u32_header(0, dataset_dim);
+    }
+
+    fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("[ANNS-DS store]: Failed to open " + dst_path +
+                               " (" + std::string(std::strerror(errno)) + ")");
+    }
+
+    if (print_log) {
+      std::printf("[ANNS-DS store]: Dataset path = %s\n", dst_path.c_str());
+      std::printf("[ANNS-DS store]: Dataset dimension = %zu, order = %s\n",
+                  data_dim,
+                  order == append_order_t::ordered ? "ordered" : "unordered");
+      std::fflush(stdout);
+    }
+  }
+
+  concurrent_store_stream(const concurrent_store_stream &) = delete;
+  concurrent_store_stream &operator=(const concurrent_store_stream &) = delete;
+
+  inline ~concurrent_store_stream() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  // Append vectors (append_order_t::unordered). Thread-safe.
+  // Returns the index of the first appended vector in the file.
+  inline std::size_t append(const T *const dataset_ptr, const std::size_t ldd,
+                            const std::size_t append_size) {
+    if (order != append_order_t::unordered) {
+      throw std::runtime_error(
+          "[ANNS-DS store]: A sequence number is required in ordered mode");
+    }
+    const auto offset = reserve(0, append_size);
+    write(offset, dataset_ptr, ldd, append_size);
+    return offset;
+  }
+
+  // Append vectors (append_order_t::ordered). Thread-safe.
+  // The vectors are placed after those of the (seq - 1)-th call, where seq
+  // starts from 0. Returns the index of the first appended vector in the file.
+  inline std::size_t append(const std::size_t seq, const T *const dataset_ptr,
+                            const std::size_t ldd,
+                            const std::size_t append_size) {
+    if (order != append_order_t::ordered) {
+      throw std::runtime_error(
+          "[ANNS-DS store]: Sequence numbers are only used in ordered mode");
+    }
+    const auto offset = reserve(seq, append_size);
+    write(offset, dataset_ptr, ldd, append_size);
+    return offset;
+  }
+
+  // Write the header and close the file. All appends must have completed.
+  inline void close() {
+    if (fd < 0) {
+      return;
+    }
+    if (header_size == 0) {
+      const auto num_data = num_reserved.load();
+      if (data_offset == 2 * sizeof(std::uint64_t)) {
+        const std::uint64_t header[2] = {num_data, dataset_dim};
+        detail::pwrite_all(fd, header, sizeof(header), 0);
+      } else {
+        try {
+          detail::check_u32_header(num_data, dataset_dim);
+        } catch (...) {
+          ::close(fd);
+          fd = -1;
+          throw;
+        }
+        const std::uint32_t header[2] = {
+            static_cast<std::uint32_t>(num_data),
+            static_cast<std::uint32_t>(dataset_dim)};
+        detail::pwrite_all(fd, header, sizeof(header), 0);
+      }
+    }
+    ::close(fd);
+    fd = -1;
+
+    if (print_log) {
+      std::printf("[ANNS-DS store]: Completed (total size = %zu)\n",
+                  num_reserved.load());
+      std::fflush(stdout);
+    }
+  }
+
+  // The number of vectors reserved so far
+  inline std::size_t size() const { return num_reserved.load(); }
+};
+
+// Read-only memory-mapped view of a dataset file
+template <class T> class mapped_dataset {
+  int fd = -1;
+  void *map_ptr = nullptr;
+  std::size_t map_size = 0;
+  layout_t layout;
+
+  inline void release() {
+    if (map_ptr != nullptr) {
+      munmap(map_ptr, map_size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    map_ptr = nullptr;
+    map_size = 0;
+    fd = -1;
+  }
+
+public:
+  inline mapped_dataset(const std::string file_path,
+                        const format_t format = format_t::FORMAT_AUTO_DETECT,
+                        const bool print_log = false) {
+    layout = load_layout<T>(file_path, format, print_log);
+    if (layout.row_stride % sizeof(T) != 0 ||
+        layout.data_offset % alignof(T) != 0) {
+      throw std::runtime_error(
+          "[ANNS-DS mapped_dataset]: Data vectors are not aligned to " +
+          std::to_string(sizeof(T)) + " bytes in " + file_path);
+    }
+
+    fd = ::open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("No such file: " + file_path);
+    }
+    map_size = layout.file_size;
+    map_ptr = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_ptr == MAP_FAILED) {
+      map_ptr = nullptr;
+      release();
+      throw std::runtime_error("[ANNS-DS mapped_dataset]: mmap failed (" +
+                               std::string(std::strerror(errno)) + ")");
+    }
+
+    if (print_log) {
+      std::printf("[ANNS-DS mapped_dataset]: Mapped %s (%zu bytes)\n",
+                  file_path.c_str(), map_size);
+      std::fflush(stdout);
+    }
+  }
+
+  mapped_dataset(const mapped_dataset &) = delete;
+  mapped_dataset &operator=(const mapped_dataset &) = delete;
 
+  inline mapped_dataset(mapped_dataset &&o) noexcept
+      : fd(o.fd), map_ptr(o.map_ptr), map_size(o.map_size), layout(o.layout) {
+    o.fd = -1;
+    o.map_ptr = nullptr;
+    o.map_size = 0;
+  }
+
+  inline mapped_dataset &operator=(mapped_dataset &&o) noexcept {
+    if (this != &o) {
+      release();
+      std::swap(fd, o.fd);
+      std::swap(map_ptr, o.map_ptr);
+      std::swap(map_size, o.map_size);
+      std::swap(layout, o.layout);
+    }
+    return *this;
+  }
+
+  inline ~mapped_dataset() { release(); }
+
+  // Pointer to the first element of the first data vector
+  inline const T *data() const {
+    return reinterpret_cast<const T *>(static_cast<const char *>(map_ptr) +
+                                       layout.data_offset);
+  }
+  inline const T *row(const std::size_t i) const { return data() + i * ld(); }
+
+  inline std::size_t size() const { return layout.num_data; }
+  inline std::size_t dim() const { return layout.data_dim; }
+  // Leading dimension in elements. For FORMAT_VECS it includes the
+  // per-vector header, i.e. row(i) = data() + i * ld().
+  inline std::size_t ld() const { return layout.row_stride / sizeof(T); }
+  // Leading dimension in bytes
+  inline std::size_t stride() const { return layout.row_stride; }
+  inline format_t format() const { return layout.format; }
+  inline const layout_t &get_layout() const { return layout; }
+};
+
+namespace detail {
+// The number of vectors sampled to compute clipped percentiles
+constexpr std::size_t sq_sample_size = 1lu << 16;
+
+template <class Q> struct sq_limits {
+  static constexpr float lowest = std::numeric_limits<Q>::lowest();
+  static constexpr float max = std::numeric_limits<Q>::max();
+};
+
+// Affine parameters mapping [min[j], max[j]] onto the range of Q
+template <class Q>
+inline sq_params_t make_sq_params(const std::vector<float> &min,
+                                  const std::vector<float> &max) {
+  sq_params_t params;
+  params.element_type = get_type_str<Q>();
+  params.scale.resize(min.size());
+  params.offset.resize(min.size());
+  for (std::size_t j = 0; j < min.size(); j++) {
+    const auto range = max[j] - min[j];
+    params.scale[j] =
+        range > 0 ? range / (sq_limits<Q>::max - sq_limits<Q>::lowest) : 1.f;
+    params.offset[j] = min[j] - sq_limits<Q>::lowest * params.scale[j];
+  }
+  return params;
+}
+
+template <class Q>
+inline void quantize_rows(Q *const dst, const float *const src,
+                          const std::size_t num_rows, const std::size_t dim,
+                          const sq_params_t &params) {
+  std::vector<float> inv_scale(dim);
+  for (std::size_t j = 0; j < dim; j++) {
+    inv_scale[j] = 1.f / params.scale[j];
+  }
+  for (std::size_t i = 0; i < num_rows; i++) {
+    for (std::size_t j = 0; j < dim; j++) {
+      const auto v = std::nearbyint((src[i * dim + j] - params.offset[j]) *
+                                    inv_scale[j]);
+      dst[i * dim + j] = static_cast<Q>(
+          std::min(std::max(v, sq_limits<Q>::lowest), sq_limits<Q>::max));
+    }
+  }
+}
+} // namespace detail
+
+// Quantize the dataset `src_path` of T (e.g. float) into the SQ8 dataset
+// `dst_path` of Q (std::int8_t or std::uint8_t) with per-dimension
+// parameters. The range of each dimension is [min, max] when
+// `clip_quantile == 0` and the [clip_quantile, 1 - clip_quantile] quantiles
+// of a sample of the dataset otherwise. The dataset is streamed from disk and
+// quantized by `num_threads` threads (0: hardware concurrency). The progress
+// of the quantization pass is reported to `observer`.
+template <class Q, class T = float>
+inline int quantize_sq8(const std::string src_path, const std::string dst_path,
+                        const format_t format = format_t::FORMAT_BIGANN,
+                        const double clip_quantile = 0,
+                        const unsigned num_threads = 0,
+                        const std::size_t batch_size = 1lu << 16,
+                        const bool print_log = false,
+                        io_observer *const observer = nullptr) {
+  static_assert(std::is_same<Q, std::int8_t>::value ||
+                    std::is_same<Q, std::uint8_t>::value,
+                "Q must be int8_t or uint8_t");
+  try {
+    const dataset_file<T> src(src_path, format_t::FORMAT_AUTO_DETECT,
+                              print_log);
+    const auto num_data = src.size();
+    const auto data_dim = src.dim();
+    std::vector<float> min(data_dim, std::numeric_limits<float>::max());
+    std::vector<float> max(data_dim, std::numeric_limits<float>::lowest());
+
+    if (clip_quantile > 0) {
+      // Percentiles of evenly spaced sample vectors
+      const auto num_samples = std::min(num_data, detail::sq_sample_size);
+      std::vector<std::size_t> ids(num_samples);
+      for (std::size_t i = 0; i < num_samples; i++) {
+        ids[i] = i * num_data / num_samples;
+      }
+      std::vector<float> samples(num_samples * data_dim);
+      if (src.load_rows(samples.data(), ids.data(), num_samples,
+                        num_threads)) {
+        return 1;
+      }
+      const auto lo = static_cast<std::size_t>(clip_quantile * num_samples);
+      const auto hi = std::min(num_samples - 1,
+                               static_cast<std::size_t>(
+                                   (1 - clip_quantile) * num_samples));
+      detail::parallel_for_chunks(
+          data_dim, 1, num_threads,
+          [&](const std::size_t j, const std::size_t) {
+            std::vector<float> column(num_samples);
+            for (std::size_t i = 0; i < num_samples; i++) {
+              column[i] = samples[i * data_dim + j];
+            }
+            std::nth_element(column.begin(), column.begin() + lo,
+                             column.end());
+            min[j] = column[lo];
+            std::nth_element(column.begin(), column.begin() + hi,
+                             column.end());
+            max[j] = column[hi];
+          });
+    } else {
+      // Per-dimension min / max in a streaming pass
+      std::mutex mtx;
+      const auto chunk_size =
+          detail::parallel_load_chunk_bytes /
+              (sizeof(float) * std::max<std::size_t>(1, data_dim)) +
+          1;
+      const auto stream = src.template stream<float>(batch_size);
+      for (const auto &batch : *stream) {
+        detail::parallel_for_chunks(
+            batch.size, chunk_size, num_threads,
+            [&](const std::size_t begin, const std::size_t end) {
+              std::vector<float> local_min(data_dim,
+                                           std::numeric_limits<float>::max());
+              std::vector<float> local_max(
+                  data_dim, std::numeric_limits<float>::lowest());
+              for (std::size_t i = begin; i < end; i++) {
+                const auto v = batch.data + i * data_dim;
+                for (std::size_t j = 0; j < data_dim; j++) {
+                  local_min[j] = std::min(local_min[j], v[j]);
+                  local_max[j] = std::max(local_max[j], v[j]);
+                }
+              }
+              std::lock_guard<std::mutex> lock(mtx);
+              for (std::size_t j = 0; j < data_dim; j++) {
+                min[j] = std::min(min[j], local_min[j]);
+                max[j] = std::max(max[j], local_max[j]);
+              }
+            });
+      }
+    }
+    const auto params = detail::make_sq_params<Q>(min, max);
+    const auto chunk_size =
+        detail::parallel_load_chunk_bytes /
+            (sizeof(float) * std::max<std::size_t>(1, data_dim)) +
+        1;
+
+    // Quantize in a second streaming pass
+    detail::io_monitor monitor(observer, num_data, print_log, "quantize_sq8",
+                               "Quantizing");
+    store_stream<Q> dst(dst_path, data_dim, format, false);
+    std::vector<Q> quantized(std::min(batch_size, num_data) * data_dim);
+    const auto stream = src.template stream<float>(batch_size);
+    for (const auto &batch : *stream) {
+      const auto t0 = monitor.get_time();
+      detail::parallel_for_chunks(
+          batch.size, chunk_size, num_threads,
+          [&](const std::size_t begin, const std::size_t end) {
+            detail::quantize_rows(quantized.data() + begin * data_dim,
+                                  batch.data + begin * data_dim, end - begin,
+                                  data_dim, params);
+          });
+      const auto t1 = monitor.get_time();
+      dst.append(quantized.data(), data_dim, batch.size);
+      if (monitor.enabled()) {
+        io_metrics_t block;
+        block.bytes_read = batch.size * data_dim * sizeof(T);
+        block.bytes_written = batch.size * data_dim * sizeof(Q);
+        block.num_done = batch.size;
+        block.convert_time = detail::io_monitor::seconds(t0, t1);
+        block.io_time =
+            detail::io_monitor::seconds(t1, detail::io_monitor::now());
+        monitor.add(block);
+      }
+    }
+    dst.close();
+    store_sq_params(dst_path, params);
+    monitor.complete();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s\n", __func__, e.what());
+    return 1;
+  }
   return 0;
 }
 } // namespace anns_dataset
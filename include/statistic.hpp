@@ -1,4 +1,7 @@
 #pragma once
+#include "anns_dataset.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -7,66 +10,975 @@
 #include <vector>
 
 namespace mtk::anns_dataset {
+// Per-dimension statistics of a dataset
+template <class T> struct dimensionwise_stats_t {
+  std::size_t num_data = 0;
+  std::vector<T> min;
+  std::vector<T> max;
+  std::vector<double> mean;
+  // Unbiased sample variance
+  std::vector<double> var;
+
+  inline std::size_t dim() const { return mean.size(); }
+};
+
 namespace detail {
-template <class T> struct stat {
-  T min = std::numeric_limits<T>::max(), max = std::numeric_limits<T>::lowest();
-  double avg = 0;
-  double var = 0;
+// Running per-dimension statistics (Welford). Accumulators of disjoint row
+// sets can be merged (Chan et al.), so each thread can process its own block.
+template <class T> struct stat_accumulator {
+  std::size_t count = 0;
+  std::vector<T> min, max;
+  std::vector<double> mean, m2;
+
+  explicit stat_accumulator(const std::size_t dim = 0)
+      : min(dim, std::numeric_limits<T>::max()),
+        max(dim, std::numeric_limits<T>::lowest()), mean(dim, 0), m2(dim, 0) {}
+
+  inline void add(const T *const ptr, const std::size_t ld,
+                  const std::size_t num_rows) {
+    const auto dim = mean.size();
+    T *const min_ptr = min.data();
+    T *const max_ptr = max.data();
+    double *const mean_ptr = mean.data();
+    double *const m2_ptr = m2.data();
+    for (std::size_t i = 0; i < num_rows; i++) {
+      const T *const v = ptr + i * ld;
+      count++;
+      const double inv_count = 1. / count;
+#pragma omp simd
+      for (std::size_t j = 0; j < dim; j++) {
+        const double x = v[j];
+        const double delta = x - mean_ptr[j];
+        mean_ptr[j] += delta * inv_count;
+        m2_ptr[j] += delta * (x - mean_ptr[j]);
+        min_ptr[j] = std::min(min_ptr[j], v[j]);
+        max_ptr[j] = std::max(max_ptr[j], v[j]);
+      }
+    }
+  }
+
+  inline void merge(const stat_accumulator &o) {
+    if (o.count == 0) {
+      return;
+    }
+    const double n = count + o.count;
+    const double a = count / n, b = o.count / n;
+    for (std::size_t j = 0; j < mean.size(); j++) {
+      const double delta = o.mean[j] - mean[j];
+      mean[j] = mean[j] * a + o.mean[j] * b;
+      m2[j] += o.m2[j] + delta * delta * count * b;
+      min[j] = std::min(min[j], o.min[j]);
+      max[j] = std::max(max[j], o.max[j]);
+    }
+    count += o.count;
+  }
+
+  inline dimensionwise_stats_t<T> get() const {
+    dimensionwise_stats_t<T> stats;
+    stats.num_data = count;
+    stats.min = min;
+    stats.max = max;
+    stats.mean = mean;
+    stats.var.resize(mean.size());
+    for (std::size_t j = 0; j < mean.size(); j++) {
+      stats.var[j] = count > 1 ? m2[j] / (count - 1) : 0;
+    }
+    return stats;
+  }
 };
 } // namespace detail
+
+// Mergeable quantile sketch (KLL). Values are kept in compactors whose
+// capacities decrease geometrically from the top level; a full compactor
+// is sorted and every other value is promoted with a doubled weight.
+template <class T> class quantile_sketch {
+  std::size_t k;
+  std::size_t n = 0;
+  std::vector<std::vector<T>> levels;
+  std::uint64_t rng_state = 0x9e3779b97f4a7c15lu;
+  // The capacities depend on the depth from the top level, so they are
+  // recomputed only when a level is added
+  std::vector<std::size_t> capacities;
+  std::size_t total_capacity = 0;
+  // The number of values kept in all levels
+  std::size_t num_stored = 0;
+
+  inline void add_level() {
+    levels.emplace_back();
+    capacities.resize(levels.size());
+    total_capacity = 0;
+    for (std::size_t h = 0; h < levels.size(); h++) {
+      const auto depth = levels.size() - 1 - h;
+      capacities[h] = std::max<std::size_t>(2, k * std::pow(2. / 3, depth));
+      total_capacity += capacities[h];
+    }
+  }
+  inline bool random_bit() {
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state & 1;
+  }
+
+  inline void compress() {
+    while (num_stored > total_capacity) {
+      for (std::size_t h = 0; h < levels.size(); h++) {
+        if (levels[h].size() < capacities[h]) {
+          continue;
+        }
+        if (h + 1 == levels.size()) {
+          add_level();
+        }
+        auto &level = levels[h];
+        std::sort(level.begin(), level.end());
+        // An odd element stays in this level
+        const auto num_compacted = level.size() / 2 * 2;
+        for (std::size_t i = random_bit(); i < num_compacted; i += 2) {
+          levels[h + 1].push_back(level[i]);
+        }
+        level.erase(level.begin(), level.begin() + num_compacted);
+        num_stored -= num_compacted / 2;
+        break;
+      }
+    }
+  }
+
+public:
+  // The rank error is roughly proportional to 1 / k
+  explicit quantile_sketch(const std::size_t k = 200) : k(k) { add_level(); }
+
+  inline void update(const T v) {
+    levels[0].push_back(v);
+    n++;
+    num_stored++;
+    if (levels[0].size() >= capacities[0]) {
+      compress();
+    }
+  }
+
+  inline void merge(const quantile_sketch &o) {
+    while (levels.size() < o.levels.size()) {
+      add_level();
+    }
+    for (std::size_t h = 0; h < o.levels.size(); h++) {
+      levels[h].insert(levels[h].end(), o.levels[h].begin(),
+                       o.levels[h].end());
+    }
+    n += o.n;
+    num_stored += o.num_stored;
+    compress();
+  }
+
+  // The number of values given to this sketch
+  inline std::size_t count() const { return n; }
+
+  // The approximate `q`-quantile (0 <= q <= 1)
+  inline T quantile(const double q) const {
+    std::vector<std::pair<T, std::uint64_t>> weighted;
+    for (std::size_t h = 0; h < levels.size(); h++) {
+      for (const auto v : levels[h]) {
+        weighted.push_back(std::make_pair(v, std::uint64_t(1) << h));
+      }
+    }
+    if (weighted.empty()) {
+      return T(0);
+    }
+    std::sort(weighted.begin(), weighted.end());
+    std::uint64_t total_weight = 0;
+    for (const auto &w : weighted) {
+      total_weight += w.second;
+    }
+    const auto target = q * total_weight;
+    std::uint64_t cumulative_weight = 0;
+    for (const auto &w : weighted) {
+      cumulative_weight += w.second;
+      if (cumulative_weight >= target) {
+        return w.first;
+      }
+    }
+    return weighted.back().first;
+  }
+};
+
+// Per-dimension histograms with `num_bins` equal-width bins over
+// [lo[j], hi[j]]. Values out of the range are counted in the edge bins.
+struct dimensionwise_histogram_t {
+  std::size_t num_bins = 0;
+  std::vector<double> lo;
+  std::vector<double> hi;
+  // counts[j * num_bins + b]
+  std::vector<std::uint64_t> counts;
+
+  inline std::size_t dim() const { return lo.size(); }
+  inline std::uint64_t count(const std::size_t j, const std::size_t b) const {
+    return counts[j * num_bins + b];
+  }
+  inline double get_bin_width(const std::size_t j) const {
+    return (hi[j] - lo[j]) / num_bins;
+  }
+};
+
+namespace detail {
+template <class T> struct histogram_accumulator {
+  dimensionwise_histogram_t histogram;
+  std::vector<double> inv_bin_width;
+
+  histogram_accumulator(const std::vector<double> &lo,
+                        const std::vector<double> &hi,
+                        const std::size_t num_bins)
+      : inv_bin_width(lo.size()) {
+    histogram.num_bins = num_bins;
+    histogram.lo = lo;
+    histogram.hi = hi;
+    histogram.counts.resize(lo.size() * num_bins, 0);
+    for (std::size_t j = 0; j < lo.size(); j++) {
+      inv_bin_width[j] = hi[j] > lo[j] ? num_bins / (hi[j] - lo[j]) : 0;
+    }
+  }
+
+  inline void add(const T *const ptr, const std::size_t ld,
+                  const std::size_t num_rows) {
+    const auto dim = histogram.dim();
+    const auto num_bins = static_cast<std::int64_t>(histogram.num_bins);
+    for (std::size_t i = 0; i < num_rows; i++) {
+      const T *const v = ptr + i * ld;
+      for (std::size_t j = 0; j < dim; j++) {
+        const auto b = static_cast<std::int64_t>(
+            (static_cast<double>(v[j]) - histogram.lo[j]) * inv_bin_width[j]);
+        const auto bin = std::min(std::max<std::int64_t>(b, 0), num_bins - 1);
+        histogram.counts[j * num_bins + bin]++;
+      }
+    }
+  }
+
+  inline void merge(const histogram_accumulator &o) {
+    for (std::size_t i = 0; i < histogram.counts.size(); i++) {
+      histogram.counts[i] += o.histogram.counts[i];
+    }
+  }
+
+  inline dimensionwise_histogram_t get() const { return histogram; }
+};
+
+template <class T> struct sketch_accumulator {
+  std::vector<quantile_sketch<T>> sketches;
+
+  sketch_accumulator(const std::size_t dim, const std::size_t k)
+      : sketches(dim, quantile_sketch<T>(k)) {}
+
+  inline void add(const T *const ptr, const std::size_t ld,
+                  const std::size_t num_rows) {
+    for (std::size_t i = 0; i < num_rows; i++) {
+      for (std::size_t j = 0; j < sketches.size(); j++) {
+        sketches[j].update(ptr[i * ld + j]);
+      }
+    }
+  }
+
+  inline void merge(const sketch_accumulator &o) {
+    for (std::size_t j = 0; j < sketches.size(); j++) {
+      sketches[j].merge(o.sketches[j]);
+    }
+  }
+
+  inline std::vector<quantile_sketch<T>> get() const { return sketches; }
+};
+
+// Run `init`-initialized accumulators over contiguous row blocks, one per
+// thread, and merge them in the thread order for reproducible results
+template <class ACC, class T>
+inline ACC accumulate_parallel(const T *const dataset_ptr,
+                               const std::size_t dataset_ld,
+                               const std::size_t dataset_size,
+                               const ACC &init) {
+  std::vector<ACC> local_accs(omp_get_max_threads(), init);
+#pragma omp parallel
+  {
+    const std::size_t num_threads = omp_get_num_threads();
+    const std::size_t tid = omp_get_thread_num();
+    const auto begin = dataset_size * tid / num_threads;
+    const auto end = dataset_size * (tid + 1) / num_threads;
+    local_accs[tid].add(dataset_ptr + begin * dataset_ld, dataset_ld,
+                        end - begin);
+  }
+
+  ACC acc = init;
+  for (const auto &a : local_accs) {
+    acc.merge(a);
+  }
+  return acc;
+}
+
+// Ids are gathered in batches of this size when sampling
+constexpr std::size_t stats_sample_batch_size = 1lu << 16;
+
+// Same as `accumulate_parallel` for the dataset file `file_path`. The file is
+// streamed (the next batch is read while the current one is processed) and
+// each batch is split into contiguous row blocks per thread. When
+// `sampling_rate < 1`, only every (1/sampling_rate)-th vector is read.
+template <class ACC, class T>
+inline ACC accumulate_file(const dataset_file<T> &file, const ACC &init,
+                           const double sampling_rate,
+                           const unsigned num_threads,
+                           const std::size_t batch_size, const bool print_log,
+                           const char *const func_name) {
+  const auto start_clock = std::chrono::steady_clock::now();
+  const auto data_dim = file.dim();
+  const int num_omp_threads =
+      num_threads == 0 ? omp_get_max_threads() : num_threads;
+
+  std::vector<ACC> local_accs(num_omp_threads, init);
+  const auto accumulate = [&](const T *const ptr, const std::size_t n) {
+#pragma omp parallel num_threads(num_omp_threads)
+    {
+      const std::size_t nt = omp_get_num_threads();
+      const std::size_t tid = omp_get_thread_num();
+      const auto begin = n * tid / nt;
+      const auto end = n * (tid + 1) / nt;
+      local_accs[tid].add(ptr + begin * data_dim, data_dim, end - begin);
+    }
+  };
+
+  std::size_t num_read = 0;
+  if (sampling_rate >= 1) {
+    const auto stream = file.stream(batch_size);
+    for (const auto &batch : *stream) {
+      accumulate(batch.data, batch.size);
+    }
+    num_read = file.size();
+  } else {
+    // Evenly spaced vectors
+    const auto num_samples = std::max<std::size_t>(
+        1, static_cast<std::size_t>(file.size() * sampling_rate));
+    std::vector<std::size_t> ids;
+    std::vector<T> buffer;
+    for (std::size_t s = 0; s < num_samples; s += stats_sample_batch_size) {
+      const auto n = std::min(stats_sample_batch_size, num_samples - s);
+      ids.resize(n);
+      for (std::size_t i = 0; i < n; i++) {
+        ids[i] = (s + i) * file.size() / num_samples;
+      }
+      buffer.resize(n * data_dim);
+      if (file.load_rows(buffer.data(), ids.data(), n, num_threads)) {
+        throw std::runtime_error("Failed to load " + file.path());
+      }
+      accumulate(buffer.data(), n);
+    }
+    num_read = num_samples;
+  }
+
+  ACC acc = init;
+  for (const auto &a : local_accs) {
+    acc.merge(a);
+  }
+
+  if (print_log) {
+    const auto elapsed_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_clock)
+            .count() *
+        1e-6;
+    const auto num_bytes = num_read * file.get_layout().row_stride;
+    std::printf("[ANNS-DS %s]: %zu / %zu vectors, %.3f s, %.3f GB/s, "
+                "%.3e vectors/s\n",
+                func_name, num_read, file.size(), elapsed_time,
+                num_bytes / elapsed_time * 1e-9, num_read / elapsed_time);
+    std::fflush(stdout);
+  }
+  return acc;
+}
+} // namespace detail
+
+// Compute the per-dimension min / max / mean / variance in a single pass.
+// Each thread processes a contiguous block of rows.
 template <class T>
-inline void print_dimensionwise_distribution(
+inline dimensionwise_stats_t<T>
+compute_dimensionwise_stats(const T *const dataset_ptr,
+                            const std::size_t dataset_ld,
+                            const std::size_t dataset_size,
+                            const std::size_t dataset_dim) {
+  return detail::accumulate_parallel(
+             dataset_ptr, dataset_ld, dataset_size,
+             detail::stat_accumulator<T>(dataset_dim))
+      .get();
+}
+
+// Compute the per-dimension statistics of the dataset file `file_path`
+// without loading it entirely. When `sampling_rate < 1`, only every
+// (1/sampling_rate)-th vector is read.
+template <class T>
+inline dimensionwise_stats_t<T>
+compute_dimensionwise_stats(const std::string file_path,
+                            const double sampling_rate = 1,
+                            const unsigned num_threads = 0,
+                            const std::size_t batch_size = 1lu << 16,
+                            const bool print_log = false) {
+  const dataset_file<T> file(file_path);
+  return detail::accumulate_file(file,
+                                 detail::stat_accumulator<T>(file.dim()),
+                                 sampling_rate, num_threads, batch_size,
+                                 print_log, __func__)
+      .get();
+}
+
+// Compute per-dimension histograms over [stats.min[j], stats.max[j]]
+template <class T>
+inline dimensionwise_histogram_t
+compute_dimensionwise_histogram(const T *const dataset_ptr,
+                                const std::size_t dataset_ld,
+                                const std::size_t dataset_size,
+                                const std::size_t num_bins,
+                                const dimensionwise_stats_t<T> &stats) {
+  const std::vector<double> lo(stats.min.begin(), stats.min.end());
+  const std::vector<double> hi(stats.max.begin(), stats.max.end());
+  return detail::accumulate_parallel(
+             dataset_ptr, dataset_ld, dataset_size,
+             detail::histogram_accumulator<T>(lo, hi, num_bins))
+      .get();
+}
+
+template <class T>
+inline dimensionwise_histogram_t compute_dimensionwise_histogram(
+    const std::string file_path, const std::size_t num_bins,
+    const dimensionwise_stats_t<T> &stats, const double sampling_rate = 1,
+    const unsigned num_threads = 0, const std::size_t batch_size = 1lu << 16,
+    const bool print_log = false) {
+  const dataset_file<T> file(file_path);
+  const std::vector<double> lo(stats.min.begin(), stats.min.end());
+  const std::vector<double> hi(stats.max.begin(), stats.max.end());
+  return detail::accumulate_file(
+             file, detail::histogram_accumulator<T>(lo, hi, num_bins),
+             sampling_rate, num_threads, batch_size, print_log, __func__)
+      .get();
+}
+
+// Compute a quantile sketch of each dimension
+template <class T>
+inline std::vector<quantile_sketch<T>> compute_dimensionwise_quantile_sketch(
     const T *const dataset_ptr, const std::size_t dataset_ld,
     const std::size_t dataset_size, const std::size_t dataset_dim,
-    const std::uint32_t graph_width = 0) {
-  std::vector<detail::stat<T>> stats(dataset_dim);
+    const std::size_t k = 200) {
+  return detail::accumulate_parallel(
+             dataset_ptr, dataset_ld, dataset_size,
+             detail::sketch_accumulator<T>(dataset_dim, k))
+      .get();
+}
 
-#pragma omp parallel
-  {
-    std::vector<detail::stat<T>> local_stats(dataset_dim);
-    for (std::size_t i = omp_get_thread_num(); i < dataset_size;
-         i += omp_get_num_threads()) {
-      for (std::size_t j = 0; j < dataset_dim; j++) {
-        const auto v = dataset_ptr[j + i * dataset_ld];
-        local_stats[j].max = std::max(local_stats[j].max, v);
-        local_stats[j].min = std::min(local_stats[j].min, v);
-        local_stats[j].avg += v;
+template <class T>
+inline std::vector<quantile_sketch<T>> compute_dimensionwise_quantile_sketch(
+    const std::string file_path, const std::size_t k = 200,
+    const double sampling_rate = 1, const unsigned num_threads = 0,
+    const std::size_t batch_size = 1lu << 16, const bool print_log = false) {
+  const dataset_file<T> file(file_path);
+  return detail::accumulate_file(file,
+                                 detail::sketch_accumulator<T>(file.dim(), k),
+                                 sampling_rate, num_threads, batch_size,
+                                 print_log, __func__)
+      .get();
+}
+
+// The `q`-quantile of each dimension
+template <class T>
+inline std::vector<T>
+get_quantiles(const std::vector<quantile_sketch<T>> &sketches,
+              const double q) {
+  std::vector<T> quantiles(sketches.size());
+  for (std::size_t j = 0; j < sketches.size(); j++) {
+    quantiles[j] = sketches[j].quantile(q);
+  }
+  return quantiles;
+}
+
+// Mean and covariance matrix of a dataset
+struct covariance_t {
+  std::size_t num_data = 0;
+  std::vector<double> mean;
+  // Unbiased covariance matrix (dim x dim, row-major)
+  std::vector<double> cov;
+
+  inline std::size_t dim() const { return mean.size(); }
+};
+
+namespace detail {
+// Rows are centered and accumulated in blocks of this size
+constexpr std::size_t covariance_row_block_size = 256;
+// Tile size of the Gram matrix
+constexpr std::size_t covariance_tile_size = 64;
+
+// Running mean and co-moment matrix. A block of rows is centered by its own
+// mean, its Gram matrix is computed tile by tile, and the result is merged
+// (Chan et al.) into the running co-moment.
+template <class T> struct covariance_accumulator {
+  std::size_t count = 0;
+  std::vector<double> mean;
+  // Upper triangle of the co-moment matrix
+  std::vector<double> m2;
+  std::vector<double> block, block_mean, block_m2;
+
+  explicit covariance_accumulator(const std::size_t dim = 0)
+      : mean(dim, 0), m2(dim * dim, 0) {}
+
+  inline void merge_moments(const std::size_t n_b,
+                            const std::vector<double> &mean_b,
+                            const std::vector<double> &m2_b) {
+    const auto dim = mean.size();
+    if (n_b == 0) {
+      return;
+    }
+    const double n = count + n_b;
+    const double factor = static_cast<double>(count) * n_b / n;
+    std::vector<double> delta(dim);
+    for (std::size_t i = 0; i < dim; i++) {
+      delta[i] = mean_b[i] - mean[i];
+    }
+    for (std::size_t i = 0; i < dim; i++) {
+      double *const m2_row = m2.data() + i * dim;
+      const double *const m2_b_row = m2_b.data() + i * dim;
+      const double di = delta[i] * factor;
+#pragma omp simd
+      for (std::size_t j = i; j < dim; j++) {
+        m2_row[j] += m2_b_row[j] + di * delta[j];
       }
     }
-#pragma omp critical
-    {
-      for (std::size_t j = 0; j < dataset_dim; j++) {
-        stats[j].max = std::max(stats[j].max, local_stats[j].max);
-        stats[j].min = std::min(stats[j].min, local_stats[j].min);
-        stats[j].avg += local_stats[j].avg;
+    for (std::size_t i = 0; i < dim; i++) {
+      mean[i] += delta[i] * (n_b / n);
+    }
+    count += n_b;
+  }
+
+  inline void add(const T *const ptr, const std::size_t ld,
+                  const std::size_t num_rows) {
+    const auto dim = mean.size();
+    block.resize(covariance_row_block_size * dim);
+    block_mean.resize(dim);
+    block_m2.resize(dim * dim);
+    for (std::size_t r0 = 0; r0 < num_rows; r0 += covariance_row_block_size) {
+      const auto nr = std::min(covariance_row_block_size, num_rows - r0);
+      // Center the block
+      std::fill(block_mean.begin(), block_mean.end(), 0.);
+      for (std::size_t r = 0; r < nr; r++) {
+        const T *const v = ptr + (r0 + r) * ld;
+#pragma omp simd
+        for (std::size_t j = 0; j < dim; j++) {
+          block_mean[j] += static_cast<double>(v[j]);
+        }
+      }
+      for (std::size_t j = 0; j < dim; j++) {
+        block_mean[j] /= nr;
       }
+      for (std::size_t r = 0; r < nr; r++) {
+        const T *const v = ptr + (r0 + r) * ld;
+        double *const b = block.data() + r * dim;
+#pragma omp simd
+        for (std::size_t j = 0; j < dim; j++) {
+          b[j] = static_cast<double>(v[j]) - block_mean[j];
+        }
+      }
+
+      // Upper triangle of the Gram matrix of the block
+      std::fill(block_m2.begin(), block_m2.end(), 0.);
+      for (std::size_t i0 = 0; i0 < dim; i0 += covariance_tile_size) {
+        const auto i1 = std::min(dim, i0 + covariance_tile_size);
+        for (std::size_t j0 = i0; j0 < dim; j0 += covariance_tile_size) {
+          const auto j1 = std::min(dim, j0 + covariance_tile_size);
+          for (std::size_t r = 0; r < nr; r++) {
+            const double *const b = block.data() + r * dim;
+            for (std::size_t i = i0; i < i1; i++) {
+              const double bi = b[i];
+              double *const g = block_m2.data() + i * dim;
+#pragma omp simd
+              for (std::size_t j = std::max(i, j0); j < j1; j++) {
+                g[j] += bi * b[j];
+              }
+            }
+          }
+        }
+      }
+      merge_moments(nr, block_mean, block_m2);
     }
   }
-  for (std::size_t j = 0; j < dataset_dim; j++) {
-    stats[j].avg /= dataset_size;
+
+  inline void merge(const covariance_accumulator &o) {
+    merge_moments(o.count, o.mean, o.m2);
+  }
+
+  inline covariance_t get() const {
+    const auto dim = mean.size();
+    covariance_t result;
+    result.num_data = count;
+    result.mean = mean;
+    result.cov.resize(dim * dim);
+    const double scale = count > 1 ? 1. / (count - 1) : 0.;
+    for (std::size_t i = 0; i < dim; i++) {
+      for (std::size_t j = i; j < dim; j++) {
+        result.cov[i * dim + j] = result.cov[j * dim + i] =
+            m2[i * dim + j] * scale;
+      }
+    }
+    return result;
+  }
+};
+} // namespace detail
+
+// Compute the mean and the covariance matrix of a dataset. Each thread
+// accumulates a contiguous block of rows.
+template <class T>
+inline covariance_t compute_covariance(const T *const dataset_ptr,
+                                       const std::size_t dataset_ld,
+                                       const std::size_t dataset_size,
+                                       const std::size_t dataset_dim) {
+  return detail::accumulate_parallel(
+             dataset_ptr, dataset_ld, dataset_size,
+             detail::covariance_accumulator<T>(dataset_dim))
+      .get();
+}
+
+template <class T>
+inline covariance_t compute_covariance(const std::string file_path,
+                                       const double sampling_rate = 1,
+                                       const unsigned num_threads = 0,
+                                       const std::size_t batch_size = 1lu
+                                                                      << 16,
+                                       const bool print_log = false) {
+  const dataset_file<T> file(file_path);
+  return detail::accumulate_file(
+             file, detail::covariance_accumulator<T>(file.dim()),
+             sampling_rate, num_threads, batch_size, print_log, __func__)
+      .get();
+}
+
+// Eigenvalues (descending) and eigenvectors of a symmetric matrix
+struct eigen_t {
+  std::vector<double> values;
+  // The k-th eigenvector is vectors[k * dim, (k + 1) * dim)
+  std::vector<double> vectors;
+};
+
+// Eigen decomposition of the symmetric matrix `a` (dim x dim) by the cyclic
+// Jacobi method
+inline eigen_t eigen_decomposition(std::vector<double> a,
+                                   const std::size_t dim,
+                                   const std::size_t max_sweeps = 100) {
+  std::vector<double> v(dim * dim, 0);
+  for (std::size_t i = 0; i < dim; i++) {
+    v[i * dim + i] = 1;
+  }
+
+  double norm = 0;
+  for (const auto x : a) {
+    norm += x * x;
+  }
+  for (std::size_t sweep = 0; sweep < max_sweeps; sweep++) {
+    double off = 0;
+    for (std::size_t p = 0; p < dim; p++) {
+      for (std::size_t q = p + 1; q < dim; q++) {
+        off += a[p * dim + q] * a[p * dim + q];
+      }
+    }
+    if (off <= 1e-30 * norm) {
+      break;
+    }
+
+    for (std::size_t p = 0; p < dim; p++) {
+      for (std::size_t q = p + 1; q < dim; q++) {
+        const auto apq = a[p * dim + q];
+        if (std::abs(apq) <= 1e-300) {
+          continue;
+        }
+        const auto theta = (a[q * dim + q] - a[p * dim + p]) / (2 * apq);
+        const auto t = (theta >= 0 ? 1. : -1.) /
+                       (std::abs(theta) + std::sqrt(theta * theta + 1));
+        const auto c = 1 / std::sqrt(t * t + 1);
+        const auto s = t * c;
+        // A <- J^T A J
+        for (std::size_t k = 0; k < dim; k++) {
+          const auto akp = a[k * dim + p];
+          const auto akq = a[k * dim + q];
+          a[k * dim + p] = c * akp - s * akq;
+          a[k * dim + q] = s * akp + c * akq;
+        }
+        for (std::size_t k = 0; k < dim; k++) {
+          const auto apk = a[p * dim + k];
+          const auto aqk = a[q * dim + k];
+          a[p * dim + k] = c * apk - s * aqk;
+          a[q * dim + k] = s * apk + c * aqk;
+        }
+        for (std::size_t k = 0; k < dim; k++) {
+          const auto vkp = v[k * dim + p];
+          const auto vkq = v[k * dim + q];
+          v[k * dim + p] = c * vkp - s * vkq;
+          v[k * dim + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+
+  // Sort by the eigenvalues
+  std::vector<std::size_t> order(dim);
+  for (std::size_t i = 0; i < dim; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](const auto x, const auto y) {
+    return a[x * dim + x] > a[y * dim + y];
+  });
+  eigen_t result;
+  result.values.resize(dim);
+  result.vectors.resize(dim * dim);
+  for (std::size_t k = 0; k < dim; k++) {
+    result.values[k] = a[order[k] * dim + order[k]];
+    for (std::size_t i = 0; i < dim; i++) {
+      result.vectors[k * dim + i] = v[i * dim + order[k]];
+    }
+  }
+  return result;
+}
+
+namespace detail {
+// Orthonormalize the rows of `q` (k x dim) by modified Gram-Schmidt
+inline void orthonormalize_rows(std::vector<double> &q, const std::size_t k,
+                                const std::size_t dim) {
+  for (std::size_t i = 0; i < k; i++) {
+    double *const qi = q.data() + i * dim;
+    for (std::size_t j = 0; j < i; j++) {
+      const double *const qj = q.data() + j * dim;
+      double dot = 0;
+#pragma omp simd reduction(+ : dot)
+      for (std::size_t l = 0; l < dim; l++) {
+        dot += qi[l] * qj[l];
+      }
+#pragma omp simd
+      for (std::size_t l = 0; l < dim; l++) {
+        qi[l] -= dot * qj[l];
+      }
+    }
+    double norm = 0;
+#pragma omp simd reduction(+ : norm)
+    for (std::size_t l = 0; l < dim; l++) {
+      norm += qi[l] * qi[l];
+    }
+    norm = std::sqrt(norm);
+    for (std::size_t l = 0; l < dim; l++) {
+      qi[l] = norm > 0 ? qi[l] / norm : (l == i ? 1. : 0.);
+    }
+  }
+}
+
+// z = q a (q: k x dim, a: symmetric dim x dim)
+inline void multiply_rows(std::vector<double> &z, const std::vector<double> &q,
+                          const std::vector<double> &a, const std::size_t k,
+                          const std::size_t dim) {
+  z.assign(k * dim, 0);
+#pragma omp parallel for collapse(2)
+  for (std::size_t i = 0; i < k; i++) {
+    for (std::size_t l = 0; l < dim; l++) {
+      const double *const a_row = a.data() + l * dim;
+      const double *const q_row = q.data() + i * dim;
+      double sum = 0;
+#pragma omp simd reduction(+ : sum)
+      for (std::size_t m = 0; m < dim; m++) {
+        sum += q_row[m] * a_row[m];
+      }
+      z[i * dim + l] = sum;
+    }
+  }
+}
+} // namespace detail
+
+// The top `num_eigens` eigenpairs of the symmetric matrix `a` (dim x dim) by
+// subspace (block power) iteration followed by a Rayleigh-Ritz step. The
+// subspace is oversampled so that close eigenvalues still converge quickly.
+inline eigen_t power_iteration(const std::vector<double> &a,
+                               const std::size_t dim,
+                               const std::size_t num_eigens,
+                               const std::size_t max_iterations = 1000,
+                               const double tolerance = 1e-12) {
+  const auto k = std::min(dim, 2 * num_eigens + 8);
+  // Deterministic pseudo random initial subspace
+  std::vector<double> q(k * dim), z;
+  std::uint64_t state = 0x2545f4914f6cdd1dlu;
+  for (auto &x : q) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    x = static_cast<double>(state >> 11) / (1lu << 53) - 0.5;
+  }
+  detail::orthonormalize_rows(q, k, dim);
+
+  for (std::size_t it = 0; it < max_iterations; it++) {
+    detail::multiply_rows(z, q, a, k, dim);
+    detail::orthonormalize_rows(z, k, dim);
+    // Converged when the leading vectors do not change
+    double diff = 0;
+    for (std::size_t i = 0; i < num_eigens; i++) {
+      double dot = 0;
+      for (std::size_t l = 0; l < dim; l++) {
+        dot += z[i * dim + l] * q[i * dim + l];
+      }
+      diff = std::max(diff, 1 - std::abs(dot));
+    }
+    std::swap(q, z);
+    if (diff < tolerance) {
+      break;
+    }
+  }
+
+  // Rayleigh-Ritz: b = q a q^T
+  detail::multiply_rows(z, q, a, k, dim);
+  std::vector<double> b(k * k);
+  for (std::size_t i = 0; i < k; i++) {
+    for (std::size_t j = 0; j < k; j++) {
+      double sum = 0;
+      for (std::size_t l = 0; l < dim; l++) {
+        sum += z[i * dim + l] * q[j * dim + l];
+      }
+      b[i * k + j] = sum;
+    }
   }
+  const auto small = eigen_decomposition(b, k);
+  eigen_t result;
+  result.values.assign(small.values.begin(),
+                       small.values.begin() + num_eigens);
+  result.vectors.assign(num_eigens * dim, 0);
+  for (std::size_t i = 0; i < num_eigens; i++) {
+    for (std::size_t j = 0; j < k; j++) {
+      const auto w = small.vectors[i * k + j];
+      for (std::size_t l = 0; l < dim; l++) {
+        result.vectors[i * dim + l] += w * q[j * dim + l];
+      }
+    }
+  }
+  return result;
+}
+
+// Principal components of a dataset: y = components (x - mean)
+struct pca_t {
+  std::vector<double> mean;
+  std::vector<double> eigenvalues;
+  // Rotation matrix (num_components x dim, row-major)
+  std::vector<float> components;
+
+  inline std::size_t dim() const { return mean.size(); }
+  inline std::size_t num_components() const { return eigenvalues.size(); }
+};
+
+// Compute the top `num_components` (0: all) principal components. The
+// components are scaled by 1/sqrt(eigenvalue) when `whiten` is true. The full
+// decomposition uses the Jacobi method and a few components the power
+// iteration.
+inline pca_t compute_pca(const covariance_t &covariance,
+                         std::size_t num_components = 0,
+                         const bool whiten = false) {
+  const auto dim = covariance.dim();
+  if (num_components == 0 || num_components > dim) {
+    num_components = dim;
+  }
+  const auto eigen = num_components * 4 >= dim
+                         ? eigen_decomposition(covariance.cov, dim)
+                         : power_iteration(covariance.cov, dim, num_components);
+
+  pca_t pca;
+  pca.mean = covariance.mean;
+  pca.eigenvalues.assign(eigen.values.begin(),
+                         eigen.values.begin() + num_components);
+  pca.components.resize(num_components * dim);
+  for (std::size_t k = 0; k < num_components; k++) {
+    const auto scale =
+        whiten ? 1. / std::sqrt(std::max(eigen.values[k], 1e-12)) : 1.;
+    for (std::size_t i = 0; i < dim; i++) {
+      pca.components[k * dim + i] = eigen.vectors[k * dim + i] * scale;
+    }
+  }
+  return pca;
+}
+
+namespace detail {
+// Rows rotated per tile, so that a component row is reused from cache
+constexpr std::size_t pca_row_tile_size = 32;
+} // namespace detail
 
-  // calc var
+// dst[i * ldd + k] = components[k] . (src[i * ld] - mean)
+template <class T>
+inline void apply_pca(float *const dst, const std::size_t ldd,
+                      const T *const src, const std::size_t ld,
+                      const std::size_t num_rows, const pca_t &pca) {
+  const auto dim = pca.dim();
+  const auto num_components = pca.num_components();
+  const auto num_tiles =
+      (num_rows + detail::pca_row_tile_size - 1) / detail::pca_row_tile_size;
 #pragma omp parallel
   {
-    std::vector<detail::stat<T>> local_stats(dataset_dim);
-    for (std::size_t i = omp_get_thread_num(); i < dataset_size;
-         i += omp_get_num_threads()) {
-      for (std::size_t j = 0; j < dataset_dim; j++) {
-        const auto v = dataset_ptr[j + i * dataset_ld] - local_stats[j].avg;
-        local_stats[j].var += v * v;
+    std::vector<float> centered(detail::pca_row_tile_size * dim);
+#pragma omp for schedule(static)
+    for (std::size_t t = 0; t < num_tiles; t++) {
+      const auto r0 = t * detail::pca_row_tile_size;
+      const auto nr = std::min(detail::pca_row_tile_size, num_rows - r0);
+      for (std::size_t r = 0; r < nr; r++) {
+        for (std::size_t i = 0; i < dim; i++) {
+          centered[r * dim + i] = static_cast<float>(
+              static_cast<double>(src[(r0 + r) * ld + i]) - pca.mean[i]);
+        }
       }
-    }
-#pragma omp critical
-    {
-      for (std::size_t j = 0; j < dataset_dim; j++) {
-        stats[j].var += local_stats[j].var;
+      for (std::size_t k = 0; k < num_components; k++) {
+        const float *const c = pca.components.data() + k * dim;
+        for (std::size_t r = 0; r < nr; r++) {
+          const float *const x = centered.data() + r * dim;
+          float sum = 0;
+#pragma omp simd reduction(+ : sum)
+          for (std::size_t i = 0; i < dim; i++) {
+            sum += c[i] * x[i];
+          }
+          dst[(r0 + r) * ldd + k] = sum;
+        }
       }
     }
   }
-  for (std::size_t j = 0; j < dataset_dim; j++) {
-    stats[j].var = std::sqrt(stats[j].var) / (dataset_size - 1);
+}
+
+// Rotate the dataset file `src_path` and write the float result to `dst_path`
+// in one streaming pass
+template <class T>
+inline int apply_pca(const std::string src_path, const std::string dst_path,
+                     const pca_t &pca,
+                     const format_t format = format_t::FORMAT_BIGANN,
+                     const std::size_t batch_size = 1lu << 16,
+                     const bool print_log = false) {
+  try {
+    load_stream<T> src(src_path, batch_size);
+    if (src.dim() != pca.dim()) {
+      throw std::runtime_error("Inconsistent dimension");
+    }
+    store_stream<float> dst(dst_path, pca.num_components(), format, false);
+    std::vector<float> rotated(std::min(batch_size, src.size()) *
+                               pca.num_components());
+    for (const auto &batch : src) {
+      apply_pca(rotated.data(), pca.num_components(), batch.data, src.ld(),
+                batch.size, pca);
+      dst.append(rotated.data(), pca.num_components(), batch.size);
+      if (print_log) {
+        std::printf("[ANNS-DS %s]: Rotating... (%4.2f %%)\r", __func__,
+                    (batch.offset + batch.size) * 100. / src.size());
+        std::fflush(stdout);
+      }
+    }
+    dst.close();
+    if (print_log) {
+      std::printf("\n[ANNS-DS %s]: Completed\n", __func__);
+      std::fflush(stdout);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[ANNS-DS %s]: %s (%s)\n", __func__, e.what(),
+                 src_path.c_str());
+    return 1;
   }
+  return 0;
+}
+
+template <class T>
+inline void print_dimensionwise_distribution(
+    const dimensionwise_stats_t<T> &stats,
+    const std::uint32_t graph_width = 0) {
+  const auto dataset_dim = stats.dim();
 
   // Print the result
   const std::uint32_t dimension_format_width =
@@ -77,17 +989,17 @@ inline void print_dimensionwise_distribution(
                 "avg", "var", "min", "max");
     for (std::size_t i = 0; i < dataset_dim; i++) {
       std::printf("%*lu | %+.2e, %+.2e, %+.2e, %+.2e\n", dimension_format_width,
-                  i, stats[i].avg, stats[i].var,
-                  static_cast<double>(stats[i].min),
-                  static_cast<double>(stats[i].max));
+                  i, stats.mean[i], stats.var[i],
+                  static_cast<double>(stats.min[i]),
+                  static_cast<double>(stats.max[i]));
     }
   } else {
     // Calc max abs
     double max_abs = 0;
     for (std::size_t j = 0; j < dataset_dim; j++) {
       max_abs = std::max(max_abs,
-                         std::max(std::abs(static_cast<double>(stats[j].max)),
-                                  std::abs(static_cast<double>(stats[j].min))));
+                         std::max(std::abs(static_cast<double>(stats.max[j])),
+                                  std::abs(static_cast<double>(stats.min[j]))));
     }
 
     std::printf("%*s | %9s, %9s, %9s, %9s | ", dimension_format_width, "dim",
@@ -103,22 +1015,125 @@ inline void print_dimensionwise_distribution(
 
     for (std::size_t i = 0; i < dataset_dim; i++) {
       std::printf("%*lu | %+.2e, %+.2e, %+.2e, %+.2e | ",
-                  dimension_format_width, i, stats[i].avg, stats[i].var,
-                  static_cast<double>(stats[i].min),
-                  static_cast<double>(stats[i].max));
+                  dimension_format_width, i, stats.mean[i], stats.var[i],
+                  static_cast<double>(stats.min[i]),
+                  static_cast<double>(stats.max[i]));
       std::uint32_t j = 0;
-      for (; j < (stats[i].min + max_abs) / (2 * max_abs) * graph_width; j++) {
+      for (; j < (stats.min[i] + max_abs) / (2 * max_abs) * graph_width; j++) {
         std::printf(" ");
       }
-      for (; j < (stats[i].avg + max_abs) / (2 * max_abs) * graph_width; j++) {
+      for (; j < (stats.mean[i] + max_abs) / (2 * max_abs) * graph_width; j++) {
         std::printf("<");
       }
       std::printf("#");
-      for (; j < (stats[i].max + max_abs) / (2 * max_abs) * graph_width; j++) {
+      for (; j < (stats.max[i] + max_abs) / (2 * max_abs) * graph_width; j++) {
         std::printf(">");
       }
       std::printf("\n");
     }
   }
 }
+
+// Draw the histogram of each dimension with density characters
+template <class T>
+inline void print_dimensionwise_distribution(
+    const dimensionwise_stats_t<T> &stats,
+    const dimensionwise_histogram_t &histogram,
+    const std::uint32_t graph_width) {
+  const auto dataset_dim = stats.dim();
+  const std::uint32_t dimension_format_width =
+      std::max(std::log10(dataset_dim) + 1, 3.);
+
+  double max_abs = 0;
+  for (std::size_t j = 0; j < dataset_dim; j++) {
+    max_abs = std::max(max_abs,
+                       std::max(std::abs(static_cast<double>(stats.max[j])),
+                                std::abs(static_cast<double>(stats.min[j]))));
+  }
+  if (max_abs == 0) {
+    max_abs = 1;
+  }
+
+  std::printf("%*s | %9s, %9s, %9s, %9s | ", dimension_format_width, "dim",
+              "avg", "var", "min", "max");
+  for (std::size_t i = 0; i < graph_width / 2; i++) {
+    std::printf("-");
+  }
+  std::printf("0");
+  for (std::size_t i = 0; i < graph_width / 2; i++) {
+    std::printf("-");
+  }
+  std::printf("\n");
+
+  const std::string ramp = " .:-=+*#%@";
+  const std::size_t num_columns = graph_width / 2 * 2 + 1;
+  const double column_width = 2 * max_abs / num_columns;
+  std::vector<double> mass(num_columns);
+  for (std::size_t i = 0; i < dataset_dim; i++) {
+    // Distribute the count of each bin to the overlapping columns
+    std::fill(mass.begin(), mass.end(), 0.);
+    const auto bin_width = histogram.get_bin_width(i);
+    for (std::size_t b = 0; b < histogram.num_bins; b++) {
+      const auto count = histogram.count(i, b);
+      if (count == 0) {
+        continue;
+      }
+      const auto bin_lo = histogram.lo[i] + b * bin_width + max_abs;
+      const auto bin_hi = bin_lo + bin_width;
+      if (bin_width == 0) {
+        const auto c = std::min<std::size_t>(bin_lo / column_width,
+                                             num_columns - 1);
+        mass[c] += count;
+        continue;
+      }
+      const auto c_begin = std::min<std::size_t>(
+          std::max(bin_lo / column_width, 0.), num_columns - 1);
+      const auto c_end = std::min<std::size_t>(
+          std::max(bin_hi / column_width, 0.), num_columns - 1);
+      for (auto c = c_begin; c <= c_end; c++) {
+        const auto overlap =
+            std::min(bin_hi, (c + 1) * column_width) -
+            std::max(bin_lo, c * column_width);
+        mass[c] += count * std::max(overlap, 0.) / bin_width;
+      }
+    }
+    const auto max_mass = *std::max_element(mass.begin(), mass.end());
+
+    std::printf("%*lu | %+.2e, %+.2e, %+.2e, %+.2e | ",
+                dimension_format_width, i, stats.mean[i], stats.var[i],
+                static_cast<double>(stats.min[i]),
+                static_cast<double>(stats.max[i]));
+    for (std::size_t c = 0; c < num_columns; c++) {
+      std::size_t level = 0;
+      if (mass[c] > 0) {
+        level = std::max<std::size_t>(
+            1, std::min<std::size_t>(
+                   ramp.size() - 1,
+                   std::ceil(mass[c] / max_mass * (ramp.size() - 1))));
+      }
+      std::printf("%c", ramp[level]);
+    }
+    std::printf("\n");
+  }
+}
+
+// Print the statistics and, when `graph_width != 0`, the histogram of each
+// dimension
+template <class T>
+inline void print_dimensionwise_distribution(
+    const T *const dataset_ptr, const std::size_t dataset_ld,
+    const std::size_t dataset_size, const std::size_t dataset_dim,
+    const std::uint32_t graph_width = 0) {
+  const auto stats = compute_dimensionwise_stats(dataset_ptr, dataset_ld,
+                                                 dataset_size, dataset_dim);
+  if (!graph_width) {
+    print_dimensionwise_distribution(stats);
+    return;
+  }
+  print_dimensionwise_distribution(
+      stats,
+      compute_dimensionwise_histogram(dataset_ptr, dataset_ld, dataset_size,
+                                      graph_width, stats),
+      graph_width);
+}
 } // namespace mtk::anns_dataset
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <anns_dataset.hpp>
 #include <cstdint>
 #include <exception>
+#include <memory>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <string>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
@@ -13,46 +16,170 @@ enum class dtype_t {
   i8,
   u8,
   f32,
+  f16,
+  bf16,
 };
 
-template <class T>
-pybind11::array_t<T> load_core(const std::string filepath, const bool log) {
-  std::size_t size = 0, dim = 0;
-  mtk::anns_dataset::load_size_info<T>(filepath, size, dim);
+// numpy dtype of the loaded array of MEM_T
+template <class MEM_T> pybind11::dtype get_numpy_dtype() {
+  return pybind11::dtype::of<MEM_T>();
+}
+template <> pybind11::dtype get_numpy_dtype<mtk::anns_dataset::float16_t>() {
+  return pybind11::dtype("float16");
+}
 
-  T *ptr = new T[size * dim];
-  if (mtk::anns_dataset::load(ptr, filepath, log)) {
-    throw std::runtime_error("Failed to load " + filepath);
+// Number of vectors in [offset, offset + size) (size = 0: up to the end)
+inline mtk::anns_dataset::range_t get_range(const std::size_t num_data,
+                                            const std::size_t offset,
+                                            const std::size_t size) {
+  const auto num_load = size == 0 && offset <= num_data ? num_data - offset
+                                                        : size;
+  if (offset > num_data || num_load > num_data - offset) {
+    throw pybind11::index_error(
+        "Range [" + std::to_string(offset) + ", " +
+        std::to_string(offset + num_load) + ") is out of the dataset size " +
+        std::to_string(num_data));
   }
+  return mtk::anns_dataset::range_t{.offset = offset, .size = num_load};
+}
 
-  pybind11::capsule destroy(ptr, [](void *f) {
-    T *p = reinterpret_cast<T *>(f);
-    delete[] p;
+// Read-only array backed by a memory-mapped file. The mapping is released
+// when the array is garbage collected.
+template <class T>
+pybind11::array map_core(const std::string filepath, const std::size_t offset,
+                         const std::size_t size, const bool log) {
+  mtk::anns_dataset::mapped_dataset<T> *mapped;
+  {
+    pybind11::gil_scoped_release release;
+    mapped = new mtk::anns_dataset::mapped_dataset<T>(
+        filepath, mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT, log);
+  }
+  pybind11::capsule destroy(mapped, [](void *f) {
+    delete reinterpret_cast<mtk::anns_dataset::mapped_dataset<T> *>(f);
   });
+  const auto range = get_range(mapped->size(), offset, size);
+
+  // For FORMAT_VECS the row stride skips the per-vector header
+  pybind11::array array(
+      get_numpy_dtype<T>(),
+      std::vector<std::size_t>{range.size, mapped->dim()},
+      std::vector<std::size_t>{mapped->stride(), sizeof(T)},
+      mapped->row(range.offset), destroy);
+  array.attr("setflags")(pybind11::arg("write") = false);
+  return array;
+}
+
+// Load a dataset of FILE_T as an array of MEM_T. The GIL is released during
+// the I/O, so other Python threads keep running.
+template <class MEM_T, class FILE_T = MEM_T>
+pybind11::array load_core(const std::string filepath, const bool log,
+                          const unsigned num_threads, const std::size_t offset,
+                          const std::size_t size, pybind11::object out) {
+  std::unique_ptr<mtk::anns_dataset::dataset_file<FILE_T>> file;
+  {
+    pybind11::gil_scoped_release release;
+    file = std::make_unique<mtk::anns_dataset::dataset_file<FILE_T>>(
+        filepath, mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT, log);
+  }
+  const auto range = get_range(file->size(), offset, size);
+  const std::size_t dim = file->dim();
 
-  const auto buffer_info = pybind11::buffer_info(
-      ptr,
-      sizeof(T), // itemsize
-      pybind11::format_descriptor<T>::format(),
-      2,                                                   // ndim
-      std::vector<std::size_t>{size, dim},                 // shape
-      std::vector<std::size_t>{dim * sizeof(T), sizeof(T)} // strides
-  );
-  return pybind11::array_t<T>(buffer_info);
+  pybind11::array array;
+  std::size_t ldd = dim;
+  if (out.is_none()) {
+    MEM_T *ptr = new MEM_T[range.size * dim];
+    pybind11::capsule destroy(ptr, [](void *f) {
+      MEM_T *p = reinterpret_cast<MEM_T *>(f);
+      delete[] p;
+    });
+    array = pybind11::array(
+        get_numpy_dtype<MEM_T>(),
+        std::vector<std::size_t>{range.size, dim},                    // shape
+        std::vector<std::size_t>{dim * sizeof(MEM_T), sizeof(MEM_T)}, // strides
+        ptr, destroy);
+  } else {
+    // Load into the given array. Rows may be strided.
+    array = out.cast<pybind11::array>();
+    if (!array.dtype().equal(get_numpy_dtype<MEM_T>())) {
+      throw pybind11::type_error("out must be an array of " +
+                                 std::string(pybind11::str(
+                                     get_numpy_dtype<MEM_T>())));
+    }
+    if (array.ndim() != 2 ||
+        static_cast<std::size_t>(array.shape(0)) != range.size ||
+        static_cast<std::size_t>(array.shape(1)) != dim) {
+      throw pybind11::value_error("out must be of shape (" +
+                                  std::to_string(range.size) + ", " +
+                                  std::to_string(dim) + ")");
+    }
+    if (array.strides(1) != static_cast<pybind11::ssize_t>(sizeof(MEM_T)) ||
+        array.strides(0) < 0 || array.strides(0) % sizeof(MEM_T) != 0) {
+      throw pybind11::value_error("Rows of out must be contiguous");
+    }
+    ldd = array.strides(0) / sizeof(MEM_T);
+  }
+  // Throws if out is read-only
+  MEM_T *const ptr = static_cast<MEM_T *>(array.mutable_data());
+
+  int res;
+  {
+    pybind11::gil_scoped_release release;
+    res = file->template load_range<MEM_T>(ptr, range, num_threads, ldd);
+  }
+  if (res) {
+    throw std::runtime_error("Failed to load " + filepath);
+  }
+  return array;
 }
 
 pybind11::object load(const std::string filepath, const dtype_t dtype,
-                      const bool log) {
+                      const bool log, const unsigned num_threads,
+                      const std::size_t offset, const std::size_t size,
+                      pybind11::object out, const bool mmap) {
+  if (mmap) {
+    if (!out.is_none()) {
+      throw pybind11::value_error("out cannot be used with mmap");
+    }
+    if (dtype == dtype_t::i32) {
+      return {map_core<std::int32_t>(filepath, offset, size, log)};
+    } else if (dtype == dtype_t::u32) {
+      return {map_core<std::uint32_t>(filepath, offset, size, log)};
+    } else if (dtype == dtype_t::i8) {
+      return {map_core<std::int8_t>(filepath, offset, size, log)};
+    } else if (dtype == dtype_t::u8) {
+      return {map_core<std::uint8_t>(filepath, offset, size, log)};
+    } else if (dtype == dtype_t::f32) {
+      return {map_core<float>(filepath, offset, size, log)};
+    } else if (dtype == dtype_t::f16) {
+      return {map_core<mtk::anns_dataset::float16_t>(filepath, offset, size,
+                                                     log)};
+    }
+    // bf16 is converted to float32 and cannot be mapped
+    throw std::runtime_error("Unsupported dtype for mmap");
+  }
+
   if (dtype == dtype_t::i32) {
-    return {load_core<std::int32_t>(filepath, log)};
+    return {load_core<std::int32_t>(filepath, log, num_threads, offset, size,
+                                    out)};
   } else if (dtype == dtype_t::u32) {
-    return {load_core<std::uint32_t>(filepath, log)};
+    return {load_core<std::uint32_t>(filepath, log, num_threads, offset, size,
+                                     out)};
   } else if (dtype == dtype_t::i8) {
-    return {load_core<std::int8_t>(filepath, log)};
+    return {load_core<std::int8_t>(filepath, log, num_threads, offset, size,
+                                   out)};
   } else if (dtype == dtype_t::u8) {
-    return {load_core<std::uint8_t>(filepath, log)};
+    return {load_core<std::uint8_t>(filepath, log, num_threads, offset, size,
+                                    out)};
   } else if (dtype == dtype_t::f32) {
-    return {load_core<float>(filepath, log)};
+    return {
+        load_core<float>(filepath, log, num_threads, offset, size, out)};
+  } else if (dtype == dtype_t::f16) {
+    return {load_core<mtk::anns_dataset::float16_t>(filepath, log, num_threads,
+                                                    offset, size, out)};
+  } else if (dtype == dtype_t::bf16) {
+    // numpy has no bfloat16 type
+    return {load_core<float, mtk::anns_dataset::bfloat16_t>(
+        filepath, log, num_threads, offset, size, out)};
   }
   throw std::runtime_error("Unsupported dtype");
 
@@ -61,9 +188,8 @@ pybind11::object load(const std::string filepath, const dtype_t dtype,
 
 template <class T>
 std::pair<std::size_t, std::size_t> get_shape_core(const std::string filepath) {
-  std::size_t size = 0, dim = 0;
-  mtk::anns_dataset::load_size_info<T>(filepath, size, dim);
-  return std::pair<std::size_t, std::size_t>{size, dim};
+  const mtk::anns_dataset::dataset_file<T> file(filepath);
+  return std::pair<std::size_t, std::size_t>{file.size(), file.dim()};
 }
 
 std::pair<std::size_t, std::size_t> get_shape(const std::string filepath,
@@ -78,6 +204,8 @@ std::pair<std::size_t, std::size_t> get_shape(const std::string filepath,
     return get_shape_core<std::uint8_t>(filepath);
   } else if (dtype == dtype_t::f32) {
     return get_shape_core<float>(filepath);
+  } else if (dtype == dtype_t::f16 || dtype == dtype_t::bf16) {
+    return get_shape_core<mtk::anns_dataset::float16_t>(filepath);
   }
   throw std::runtime_error("Unsupported dtype");
 
@@ -104,11 +232,257 @@ void store(pybind11::array_t<T> &buf, const std::string filepath,
   }
 }
 
+// Store a float array as f16 or bf16 (rounded to nearest even)
+void store_as(pybind11::array_t<float> &buf, const std::string filepath,
+              const mtk::anns_dataset::format_t format,
+              const dtype_t file_dtype, const bool log) {
+  pybind11::buffer_info buf_info = buf.request();
+  if (buf_info.ndim != 2) {
+    throw std::runtime_error("ndim must be 2 but " +
+                             std::to_string(buf_info.ndim) + "is given.");
+  }
+  const std::size_t size = buf_info.shape[0];
+  const std::size_t dim = buf_info.shape[1];
+  const auto ptr = static_cast<const float *>(buf_info.ptr);
+
+  int res = 1;
+  if (file_dtype == dtype_t::f16) {
+    res = mtk::anns_dataset::store<mtk::anns_dataset::float16_t>(
+        filepath, size, dim, ptr, format, log);
+  } else if (file_dtype == dtype_t::bf16) {
+    res = mtk::anns_dataset::store<mtk::anns_dataset::bfloat16_t>(
+        filepath, size, dim, ptr, format, log);
+  } else if (file_dtype == dtype_t::f32) {
+    res = mtk::anns_dataset::store(filepath, size, dim, ptr, format, log);
+  } else {
+    throw std::runtime_error("Unsupported dtype");
+  }
+  if (res) {
+    throw std::runtime_error("Failed to save " + filepath);
+  }
+}
+
+// Batch iterator over a dataset file. The next batch is prefetched by a
+// background thread while Python processes the current one.
+template <class MEM_T, class FILE_T = MEM_T> class load_stream_py {
+  std::unique_ptr<mtk::anns_dataset::load_stream<MEM_T, FILE_T>> stream;
+
+public:
+  load_stream_py(const std::string filepath, const std::size_t batch_size,
+                 const std::size_t offset, const std::size_t size,
+                 const bool log) {
+    std::unique_ptr<mtk::anns_dataset::dataset_file<FILE_T>> file;
+    {
+      pybind11::gil_scoped_release release;
+      file = std::make_unique<mtk::anns_dataset::dataset_file<FILE_T>>(
+          filepath, mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT, log);
+    }
+    const auto range = get_range(file->size(), offset, size);
+    pybind11::gil_scoped_release release;
+    stream = file->template stream<MEM_T>(batch_size, range);
+  }
+
+  // The batch is copied out since its buffer is reused by the prefetcher
+  pybind11::array next() {
+    typename mtk::anns_dataset::load_stream<MEM_T, FILE_T>::batch_t batch;
+    bool has_batch;
+    {
+      pybind11::gil_scoped_release release;
+      has_batch = stream->next(batch);
+    }
+    if (!has_batch) {
+      throw pybind11::stop_iteration();
+    }
+
+    const std::size_t dim = stream->dim();
+    pybind11::array array(get_numpy_dtype<MEM_T>(),
+                          std::vector<std::size_t>{batch.size, dim});
+    MEM_T *const ptr = static_cast<MEM_T *>(array.mutable_data());
+    {
+      pybind11::gil_scoped_release release;
+      std::copy(batch.data, batch.data + batch.size * dim, ptr);
+    }
+    return array;
+  }
+
+  std::size_t size() const { return stream->size(); }
+  std::size_t dim() const { return stream->dim(); }
+  std::size_t get_num_batches() const { return stream->get_num_batches(); }
+};
+
+// Writer appending 2D arrays to a dataset file. Rows may be strided.
+template <class T> class store_stream_py {
+  std::unique_ptr<mtk::anns_dataset::store_stream<T>> stream;
+  const std::size_t dim;
+
+  template <class SRC_T> void append_core(const pybind11::array &array) {
+    const std::size_t size = array.shape(0);
+    const auto ptr = static_cast<const SRC_T *>(array.data());
+    const std::size_t ldd =
+        size > 1 ? array.strides(0) / sizeof(SRC_T) : dim;
+    pybind11::gil_scoped_release release;
+    stream->append(ptr, ldd, size);
+  }
+
+public:
+  store_stream_py(const std::string filepath, const std::size_t dim,
+                  const mtk::anns_dataset::format_t format, const bool log,
+                  const bool write_metadata)
+      : dim(dim) {
+    stream = std::make_unique<mtk::anns_dataset::store_stream<T>>(
+        filepath, dim, format, log,
+        mtk::anns_dataset::store_stream<T>::default_buffer_size,
+        write_metadata);
+  }
+
+  void append(pybind11::array array) {
+    if (array.ndim() != 2 || static_cast<std::size_t>(array.shape(1)) != dim) {
+      throw pybind11::value_error("The array must be of shape (n, " +
+                                  std::to_string(dim) + ")");
+    }
+    // Only arrays with non-contiguous elements in a row are copied
+    if (array.strides(1) != array.itemsize() || array.strides(0) < 0 ||
+        array.strides(0) % array.itemsize() != 0) {
+      array = pybind11::module_::import("numpy").attr("ascontiguousarray")(
+          array);
+    }
+
+    if constexpr (std::is_same_v<T, mtk::anns_dataset::float16_t> ||
+                  std::is_same_v<T, mtk::anns_dataset::bfloat16_t>) {
+      // Rounded to nearest even
+      if (array.dtype().equal(pybind11::dtype::of<float>())) {
+        append_core<float>(array);
+        return;
+      }
+    }
+    if constexpr (!std::is_same_v<T, mtk::anns_dataset::bfloat16_t>) {
+      if (array.dtype().equal(get_numpy_dtype<T>())) {
+        append_core<T>(array);
+        return;
+      }
+    }
+    throw pybind11::type_error("Unsupported dtype " +
+                               std::string(pybind11::str(array.dtype())));
+  }
+
+  void close() {
+    pybind11::gil_scoped_release release;
+    stream->close();
+  }
+
+  std::size_t size() const { return stream->size(); }
+};
+
+template <class MEM_T, class FILE_T = MEM_T>
+void register_load_stream(pybind11::module_ &m, const std::string name) {
+  using stream_t = load_stream_py<MEM_T, FILE_T>;
+  pybind11::class_<stream_t>(m, name.c_str())
+      .def("__iter__", [](stream_t &s) -> stream_t & { return s; },
+           pybind11::return_value_policy::reference_internal)
+      .def("__next__", &stream_t::next)
+      .def("__len__", &stream_t::get_num_batches)
+      .def_property_readonly("size", &stream_t::size)
+      .def_property_readonly("dim", &stream_t::dim);
+}
+
+template <class T>
+void register_store_stream(pybind11::module_ &m, const std::string name) {
+  using stream_t = store_stream_py<T>;
+  pybind11::class_<stream_t>(m, name.c_str())
+      .def("append", &stream_t::append, pybind11::arg("buffer"))
+      .def("close", &stream_t::close)
+      .def("__enter__", [](stream_t &s) -> stream_t & { return s; },
+           pybind11::return_value_policy::reference_internal)
+      .def("__exit__",
+           [](stream_t &s, pybind11::object, pybind11::object,
+              pybind11::object) { s.close(); })
+      .def_property_readonly("size", &stream_t::size);
+}
+
+pybind11::object load_stream(const std::string filepath, const dtype_t dtype,
+                             const std::size_t batch_size,
+                             const std::size_t offset, const std::size_t size,
+                             const bool log) {
+  const auto take = pybind11::return_value_policy::take_ownership;
+  if (dtype == dtype_t::i32) {
+    return pybind11::cast(new load_stream_py<std::int32_t>(
+                              filepath, batch_size, offset, size, log),
+                          take);
+  } else if (dtype == dtype_t::u32) {
+    return pybind11::cast(new load_stream_py<std::uint32_t>(
+                              filepath, batch_size, offset, size, log),
+                          take);
+  } else if (dtype == dtype_t::i8) {
+    return pybind11::cast(new load_stream_py<std::int8_t>(
+                              filepath, batch_size, offset, size, log),
+                          take);
+  } else if (dtype == dtype_t::u8) {
+    return pybind11::cast(new load_stream_py<std::uint8_t>(
+                              filepath, batch_size, offset, size, log),
+                          take);
+  } else if (dtype == dtype_t::f32) {
+    return pybind11::cast(
+        new load_stream_py<float>(filepath, batch_size, offset, size, log),
+        take);
+  } else if (dtype == dtype_t::f16) {
+    return pybind11::cast(new load_stream_py<mtk::anns_dataset::float16_t>(
+                              filepath, batch_size, offset, size, log),
+                          take);
+  } else if (dtype == dtype_t::bf16) {
+    // numpy has no bfloat16 type
+    return pybind11::cast(
+        new load_stream_py<float, mtk::anns_dataset::bfloat16_t>(
+            filepath, batch_size, offset, size, log),
+        take);
+  }
+  throw std::runtime_error("Unsupported dtype");
+}
+
+pybind11::object store_stream(const std::string filepath, const std::size_t dim,
+                              const mtk::anns_dataset::format_t format,
+                              const dtype_t dtype, const bool log,
+                              const bool write_metadata) {
+  const auto take = pybind11::return_value_policy::take_ownership;
+  if (dtype == dtype_t::i32) {
+    return pybind11::cast(new store_stream_py<std::int32_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  } else if (dtype == dtype_t::u32) {
+    return pybind11::cast(new store_stream_py<std::uint32_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  } else if (dtype == dtype_t::i8) {
+    return pybind11::cast(new store_stream_py<std::int8_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  } else if (dtype == dtype_t::u8) {
+    return pybind11::cast(new store_stream_py<std::uint8_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  } else if (dtype == dtype_t::f32) {
+    return pybind11::cast(new store_stream_py<float>(filepath, dim, format, log,
+                                                     write_metadata),
+                          take);
+  } else if (dtype == dtype_t::f16) {
+    return pybind11::cast(new store_stream_py<mtk::anns_dataset::float16_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  } else if (dtype == dtype_t::bf16) {
+    return pybind11::cast(new store_stream_py<mtk::anns_dataset::bfloat16_t>(
+                              filepath, dim, format, log, write_metadata),
+                          take);
+  }
+  throw std::runtime_error("Unsupported dtype");
+}
+
 PYBIND11_MODULE(anns_dataset, m) {
   m.doc() = "anns_dataset_loader";
 
   m.def("load", &load, "", pybind11::arg("filepath"), pybind11::arg("dtype"),
-        pybind11::arg("output_log") = false);
+        pybind11::arg("output_log") = false, pybind11::arg("num_threads") = 1,
+        pybind11::arg("offset") = 0, pybind11::arg("size") = 0,
+        pybind11::arg("out") = pybind11::none(),
+        pybind11::arg("mmap") = false);
   m.def("store", &store<std::int32_t>, "", pybind11::arg("buffer"),
         pybind11::arg("filepath"), pybind11::arg("format"),
         pybind11::arg("output_log") = false);
@@ -124,9 +498,37 @@ PYBIND11_MODULE(anns_dataset, m) {
   m.def("store", &store<float>, "", pybind11::arg("buffer"),
         pybind11::arg("filepath"), pybind11::arg("format"),
         pybind11::arg("output_log") = false);
+  m.def("store", &store_as, "", pybind11::arg("buffer"),
+        pybind11::arg("filepath"), pybind11::arg("format"),
+        pybind11::arg("file_dtype"), pybind11::arg("output_log") = false);
   m.def("get_shape", &get_shape, "", pybind11::arg("filepath"),
         pybind11::arg("dtype"));
 
+  register_load_stream<std::int32_t>(m, "load_stream_i32");
+  register_load_stream<std::uint32_t>(m, "load_stream_u32");
+  register_load_stream<std::int8_t>(m, "load_stream_i8");
+  register_load_stream<std::uint8_t>(m, "load_stream_u8");
+  register_load_stream<float>(m, "load_stream_f32");
+  register_load_stream<mtk::anns_dataset::float16_t>(m, "load_stream_f16");
+  register_load_stream<float, mtk::anns_dataset::bfloat16_t>(
+      m, "load_stream_bf16");
+  m.def("load_stream", &load_stream, "", pybind11::arg("filepath"),
+        pybind11::arg("dtype"), pybind11::arg("batch_size"),
+        pybind11::arg("offset") = 0, pybind11::arg("size") = 0,
+        pybind11::arg("output_log") = false);
+
+  register_store_stream<std::int32_t>(m, "store_stream_i32");
+  register_store_stream<std::uint32_t>(m, "store_stream_u32");
+  register_store_stream<std::int8_t>(m, "store_stream_i8");
+  register_store_stream<std::uint8_t>(m, "store_stream_u8");
+  register_store_stream<float>(m, "store_stream_f32");
+  register_store_stream<mtk::anns_dataset::float16_t>(m, "store_stream_f16");
+  register_store_stream<mtk::anns_dataset::bfloat16_t>(m, "store_stream_bf16");
+  m.def("store_stream", &store_stream, "", pybind11::arg("filepath"),
+        pybind11::arg("dim"), pybind11::arg("format"), pybind11::arg("dtype"),
+        pybind11::arg("output_log") = false,
+        pybind11::arg("write_metadata") = false);
+
   pybind11::enum_<mtk::anns_dataset::format_t>(m, "format_t")
       .value("FORMAT_VECS", mtk::anns_dataset::format_t::FORMAT_VECS)
       .value("FORMAT_BIGANN", mtk::anns_dataset::format_t::FORMAT_BIGANN)
@@ -138,5 +540,7 @@ PYBIND11_MODULE(anns_dataset, m) {
       .value("u8", dtype_t::u8)
       .value("i8", dtype_t::i8)
       .value("f32", dtype_t::f32)
+      .value("f16", dtype_t::f16)
+      .value("bf16", dtype_t::bf16)
       .export_values();
 }
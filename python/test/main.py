@@ -40,3 +40,78 @@ def test_load_store(d):
 
 test_load_store(ad.f32)
 test_get_shape('a.vec', ad.f32)
+
+def test_load_store_half(d):
+    print("# " + sys._getframe().f_code.co_name)
+    size = 10000
+    dim = 100
+    ds_A = np.random.rand(size, dim).astype('float32')
+
+    ad.store(ds_A, 'a.vec', ad.FORMAT_VECS, d)
+
+    ds_B = ad.load('a.vec', d).astype('float32')
+
+    # bf16 keeps 8 significant bits
+    diff = np.max(np.abs(ds_A - ds_B))
+    print(diff)
+    if diff <= 2**-8:
+        print("PASSED")
+    else:
+        print("FAILED")
+
+test_load_store_half(ad.f16)
+test_load_store_half(ad.bf16)
+
+def test_load_options(d):
+    print("# " + sys._getframe().f_code.co_name)
+    size = 10000
+    dim = 100
+    ds_A = np.random.rand(size, dim).astype(dtype_conv(d))
+
+    ad.store(ds_A, 'a.vec', ad.FORMAT_VECS)
+
+    # Parallel partial load
+    ds_B = ad.load('a.vec', d, num_threads=4, offset=100, size=2000)
+    # Into a strided array
+    out = np.zeros((size, dim + 3), dtype=dtype_conv(d))
+    ad.load('a.vec', d, out=out[:, :dim])
+    # Memory-mapped read-only view
+    ds_C = ad.load('a.vec', d, mmap=True)
+
+    if (np.array_equal(ds_A[100:2100], ds_B)
+            and np.array_equal(ds_A, out[:, :dim])
+            and np.array_equal(ds_A, ds_C)
+            and not ds_C.flags.writeable):
+        print("PASSED")
+    else:
+        print("FAILED")
+
+test_load_options(ad.f32)
+
+def test_stream(d):
+    print("# " + sys._getframe().f_code.co_name)
+    size = 10000
+    dim = 100
+    ds_A = np.random.rand(size, dim + 3).astype(dtype_conv(d))
+
+    # Non-contiguous rows are written through the stride
+    with ad.store_stream('a.vec', dim, ad.FORMAT_BIGANN, d) as ss:
+        for i in range(0, size, 3000):
+            ss.append(ds_A[i:i + 3000, :dim])
+
+    batches = [b for b in ad.load_stream('a.vec', d, 3000)]
+    ds_B = np.concatenate(batches)
+
+    # An offset past the end is rejected as in load
+    try:
+        ad.load_stream('a.vec', d, 3000, offset=size + 1)
+        out_of_range = False
+    except IndexError:
+        out_of_range = True
+
+    if np.array_equal(ds_A[:, :dim], ds_B) and len(batches) == 4 and out_of_range:
+        print("PASSED")
+    else:
+        print("FAILED")
+
+test_stream(ad.f32)
@@ -1,8 +1,12 @@
 #include <anns_dataset.hpp>
 #include <statistic.hpp>
 
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -86,6 +90,55 @@ void test_core(const std::size_t dataset_size, const std::uint32_t dataset_dim,
       }
     }
     EXPECTED_TRUE(!error, test_name, "Check dataset data");
+
+    // Load with conversion
+    std::vector<float> dataset_f32(dataset_size * dataset_ld);
+    mtk::anns_dataset::load<float, data_t>(dataset_f32.data(), file_name);
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        const auto v = src_dataset[i * src_dataset_ld + j];
+        error = error || (dataset_f32[i * dataset_ld + j] !=
+                          static_cast<float>(v));
+      }
+    }
+    EXPECTED_TRUE(!error, test_name, "Check converted dataset data");
+
+    // Explicit format including the header width
+    std::fill(dataset.begin(), dataset.end(), 0);
+    mtk::anns_dataset::load(dataset.data(), file_name, false,
+                            file_format |
+                                mtk::anns_dataset::format_t::HEADER_U32);
+    error = false;
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        error = error || (dataset[i * dataset_ld + j] !=
+                          src_dataset[i * src_dataset_ld + j]);
+      }
+    }
+    EXPECTED_TRUE(!error, test_name,
+                  "Check dataset data loaded with an explicit format");
+  }
+
+  // Mapped dataset test
+  {
+    const mtk::anns_dataset::mapped_dataset<data_t> mapped(file_name);
+
+    EXPECTED_TRUE(mapped.size() == dataset_size, test_name,
+                  "Check dataset size of mapped dataset");
+    EXPECTED_TRUE(mapped.dim() == dataset_dim, test_name,
+                  "Check dataset dim of mapped dataset");
+
+    // check data
+    bool error = false;
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        error = error || (mapped.row(i)[j] !=
+                          src_dataset[i * src_dataset_ld + j]) ||
+                (mapped.data()[i * mapped.ld() + j] !=
+                 src_dataset[i * src_dataset_ld + j]);
+      }
+    }
+    EXPECTED_TRUE(!error, test_name, "Check mapped dataset data");
   }
 
   // Partial load test
@@ -111,10 +164,257 @@ void test_core(const std::size_t dataset_size, const std::uint32_t dataset_dim,
     EXPECTED_TRUE(!error, test_name, "Check partial load dataset data");
   }
 
-  // Store stream
+  // Parallel load test
+  {
+    const std::size_t offset = dataset_size / 10;
+    const std::size_t size = dataset_size - offset;
+
+    const auto dataset_ld = dataset_dim;
+    std::vector<data_t> dataset(size * dataset_ld);
+    std::vector<double> dataset_conv(size * dataset_ld);
+    const auto res =
+        mtk::anns_dataset::load_parallel(
+            dataset.data(), file_name, 4, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = offset, .size = size}) ||
+        mtk::anns_dataset::load_parallel<double, data_t>(
+            dataset_conv.data(), file_name, 3, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = offset, .size = size});
+    EXPECTED_TRUE(res == 0, test_name, "Check parallel load return value");
+
+    // check data
+    bool error = false;
+    for (std::size_t i = 0; i < size; i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        const auto v = src_dataset[(offset + i) * src_dataset_ld + j];
+        error = error || (dataset[i * dataset_ld + j] != v) ||
+                (dataset_conv[i * dataset_ld + j] != static_cast<double>(v));
+      }
+    }
+    EXPECTED_TRUE(!error, test_name, "Check parallel load dataset data");
+  }
+
+  // Padded load test
+  {
+    const auto dataset_ld =
+        mtk::anns_dataset::get_aligned_ld<data_t>(dataset_dim, 64);
+    const auto padding_value = static_cast<data_t>(7);
+    const auto no_range = mtk::anns_dataset::range_t{.offset = 0, .size = 0};
+    const auto auto_format = mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT;
+
+    std::vector<std::vector<data_t>> datasets(
+        4, std::vector<data_t>(dataset_size * dataset_ld));
+    std::vector<std::size_t> ids(dataset_size);
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      ids[i] = i;
+    }
+    auto res =
+        mtk::anns_dataset::load(datasets[0].data(), file_name, false,
+                                auto_format, no_range, false, dataset_ld,
+                                padding_value) ||
+        mtk::anns_dataset::load_parallel(datasets[1].data(), file_name, 2,
+                                         false, auto_format, no_range, false,
+                                         dataset_ld, padding_value) ||
+        mtk::anns_dataset::load_rows(datasets[2].data(), file_name, ids.data(),
+                                     ids.size(), 2, false, auto_format,
+                                     dataset_ld, padding_value);
+    mtk::anns_dataset::load_stream<data_t> ls(file_name, 100, auto_format,
+                                              no_range, false, dataset_ld,
+                                              padding_value);
+    for (const auto &batch : ls) {
+      std::copy(batch.data, batch.data + batch.size * ls.ld(),
+                datasets[3].data() + batch.offset * dataset_ld);
+    }
+
+    // check data
+    bool error = (dataset_ld * sizeof(data_t)) % 64 != 0 || res != 0;
+    for (const auto &dataset : datasets) {
+      for (std::size_t i = 0; i < dataset_size; i++) {
+        for (std::uint32_t j = 0; j < dataset_ld; j++) {
+          const auto v = j < dataset_dim ? src_dataset[i * src_dataset_ld + j]
+                                         : padding_value;
+          error = error || (dataset[i * dataset_ld + j] != v);
+        }
+      }
+    }
+    EXPECTED_TRUE(!error, test_name, "Check padded load dataset data");
+  }
+
+  // Projection load test. size == 0 loads up to the end
+  for (const auto &projection : std::vector<mtk::anns_dataset::projection_t>{
+           mtk::anns_dataset::projection_t::window(dataset_dim / 3,
+                                                   dataset_dim / 2),
+           mtk::anns_dataset::projection_t::list(
+               {dataset_dim - 1, 0, dataset_dim / 2, dataset_dim / 2})}) {
+    for (const std::size_t range_size : {dataset_size / 2, std::size_t(0)}) {
+      const std::size_t offset = dataset_size / 10;
+      const std::size_t size =
+          range_size == 0 ? dataset_size - offset : range_size;
+      const auto proj_dim = projection.get_dim(dataset_dim);
+
+      std::vector<float> dataset(size * proj_dim);
+      const auto res = mtk::anns_dataset::load<float, data_t>(
+          dataset.data(), file_name, false,
+          mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+          mtk::anns_dataset::range_t{.offset = offset, .size = range_size},
+          false, 0, 0.f, projection);
+
+      // check data
+      bool error = res != 0;
+      for (std::size_t i = 0; i < size; i++) {
+        for (std::size_t k = 0; k < proj_dim; k++) {
+          const auto j = projection.indices.empty() ? projection.offset + k
+                                                    : projection.indices[k];
+          error = error ||
+                  (dataset[i * proj_dim + k] !=
+                   static_cast<float>(
+                       src_dataset[(offset + i) * src_dataset_ld + j]));
+        }
+      }
+      EXPECTED_TRUE(!error, test_name, "Check projection load dataset data");
+    }
+  }
+
+  // Out of range projection load test
+  {
+    std::vector<float> dataset(dataset_dim);
+    const auto res = mtk::anns_dataset::load<float, data_t>(
+        dataset.data(), file_name, false,
+        mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+        mtk::anns_dataset::range_t{.offset = dataset_size + 1, .size = 0},
+        false, 0, 0.f, mtk::anns_dataset::projection_t::window(1, 1));
+    EXPECTED_TRUE(res != 0, test_name, "Check out of range projection load");
+  }
+
+  // Gather load test
+  {
+    std::vector<index_t> ids;
+    for (std::size_t i = 0; i < dataset_size / 5; i++) {
+      ids.push_back((i * 7919 + (i % 3) * dataset_size / 2) % dataset_size);
+    }
+    ids.push_back(ids[0]);
+
+    std::vector<data_t> dataset(ids.size() * dataset_dim);
+    std::vector<float> dataset_f32(ids.size() * dataset_dim);
+    const auto res =
+        mtk::anns_dataset::load_rows(dataset.data(), file_name, ids.data(),
+                                     ids.size(), 4) ||
+        mtk::anns_dataset::load_rows<float, data_t>(
+            dataset_f32.data(), file_name, ids.data(), ids.size(), 2);
+
+    // check data
+    bool error = res != 0;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        const auto v = src_dataset[ids[i] * src_dataset_ld + j];
+        error = error || (dataset[i * dataset_dim + j] != v) ||
+                (dataset_f32[i * dataset_dim + j] != static_cast<float>(v));
+      }
+    }
+    EXPECTED_TRUE(!error, test_name, "Check gather load dataset data");
+  }
+
+  // Load stream test
   {
+    const std::size_t offset = dataset_size / 10;
+    const std::size_t batch_size = 97;
+
+    bool error = false;
+    std::size_t num_loaded = 0;
+    mtk::anns_dataset::load_stream<double, data_t> ls(
+        file_name, batch_size, mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+        mtk::anns_dataset::range_t{.offset = offset, .size = 0});
+    for (const auto &batch : ls) {
+      error = error || (batch.offset != offset + num_loaded) ||
+              (batch.size > batch_size);
+      for (std::size_t i = 0; i < batch.size; i++) {
+        for (std::uint32_t j = 0; j < dataset_dim; j++) {
+          const auto v = src_dataset[(batch.offset + i) * src_dataset_ld + j];
+          error = error ||
+                  (batch.data[i * dataset_dim + j] != static_cast<double>(v));
+        }
+      }
+      num_loaded += batch.size;
+    }
+    EXPECTED_TRUE(!error && num_loaded == dataset_size - offset, test_name,
+                  "Check load stream");
+  }
+
+  // Out of range stream test
+  {
+    bool thrown = false;
+    try {
+      mtk::anns_dataset::load_stream<data_t> ls(
+          file_name, 97, mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+          mtk::anns_dataset::range_t{.offset = dataset_size + 1, .size = 0});
+    } catch (const std::exception &) {
+      thrown = true;
+    }
+    EXPECTED_TRUE(thrown, test_name, "Check out of range load stream");
+  }
+
+  // Out of range load test. load and load_parallel reject the same ranges
+  for (const auto range : std::vector<mtk::anns_dataset::range_t>{
+           {.offset = dataset_size + 1, .size = 0},
+           {.offset = dataset_size / 2, .size = dataset_size}}) {
+    std::vector<data_t> dataset(dataset_dim);
+    const auto auto_format = mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT;
+    const auto res = mtk::anns_dataset::load(dataset.data(), file_name, false,
+                                             auto_format, range);
+    const auto res_parallel = mtk::anns_dataset::load_parallel(
+        dataset.data(), file_name, 2, false, auto_format, range);
+    EXPECTED_TRUE(res != 0 && res_parallel != 0, test_name,
+                  "Check out of range load");
+  }
+
+  // VECS header validation test
+  if ((file_format & mtk::anns_dataset::format_t::FORMAT_VECS) !=
+      mtk::anns_dataset::format_t::FORMAT_UNKNOWN) {
+    std::vector<data_t> dataset(dataset_size * dataset_dim);
+    const auto res_valid =
+        mtk::anns_dataset::load(
+            dataset.data(), file_name, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = 0, .size = 0}, true) ||
+        mtk::anns_dataset::load_parallel(
+            dataset.data(), file_name, 2, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = 0, .size = 0}, true);
+    EXPECTED_TRUE(res_valid == 0, test_name, "Check valid VECS headers");
+
+    // Break the header of the last vector
+    const auto layout = mtk::anns_dataset::load_layout<data_t>(file_name);
+    {
+      std::fstream fs(file_name,
+                      std::ios::binary | std::ios::in | std::ios::out);
+      fs.seekp((dataset_size - 1) * layout.row_stride);
+      const std::uint8_t broken_dim = dataset_dim + 1;
+      fs.write(reinterpret_cast<const char *>(&broken_dim), 1);
+    }
+    const auto res_invalid =
+        mtk::anns_dataset::load(
+            dataset.data(), file_name, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = 0, .size = 0}, true) ==
+            0 ||
+        mtk::anns_dataset::load_parallel(
+            dataset.data(), file_name, 2, false,
+            mtk::anns_dataset::format_t::FORMAT_AUTO_DETECT,
+            mtk::anns_dataset::range_t{.offset = 0, .size = 0}, true) == 0;
+    EXPECTED_TRUE(!res_invalid, test_name, "Check broken VECS headers");
+
+    // Restore the dataset file
+    mtk::anns_dataset::store(file_name, dataset_size, dataset_dim,
+                             src_dataset.data(), file_format);
+  }
+
+  // Store stream
+  for (const auto buffer_size : std::vector<std::size_t>{
+           mtk::anns_dataset::store_stream<data_t>::default_buffer_size,
+           1000}) {
     mtk::anns_dataset::store_stream<data_t> ss(file_name, dataset_dim,
-                                               file_format);
+                                               file_format, false, buffer_size);
     const std::size_t num_split = 10;
     for (std::size_t i = 0; i < num_split; i++) {
       const auto offset = i * dataset_size / num_split;
@@ -138,7 +438,204 @@ void test_core(const std::size_t dataset_size, const std::uint32_t dataset_dim,
                           src_dataset[i * src_dataset_ld + j]);
       }
     }
-    EXPECTED_TRUE(!error, test_name, "Check store stream");
+    EXPECTED_TRUE(!error, test_name,
+                  "Check store stream (buffer size = " +
+                      std::to_string(buffer_size) + ")");
+  }
+
+  // Write errors (ENOSPC) are reported by close()
+  {
+    bool rejected = false;
+    try {
+      mtk::anns_dataset::store_stream<data_t> ss("/dev/full", dataset_dim,
+                                                 file_format);
+      ss.append(src_dataset.data(), src_dataset_ld, dataset_size);
+      ss.close();
+    } catch (const std::runtime_error &) {
+      rejected = true;
+    }
+    EXPECTED_TRUE(rejected, test_name, "Check store stream write error");
+  }
+
+  // A dimension over 2^32-1 does not fit a 32-bit header
+  {
+    const std::size_t large_dim = 1lu << 32;
+    const auto u32_format =
+        file_format | mtk::anns_dataset::format_t::HEADER_U32;
+    bool rejected = false, concurrent_rejected = false;
+    try {
+      mtk::anns_dataset::store_stream<data_t> ss(file_name, large_dim,
+                                                 u32_format);
+    } catch (const std::runtime_error &) {
+      rejected = true;
+    }
+    try {
+      mtk::anns_dataset::concurrent_store_stream<data_t> ss(
+          file_name, large_dim, u32_format);
+    } catch (const std::runtime_error &) {
+      concurrent_rejected = true;
+    }
+    EXPECTED_TRUE(rejected && concurrent_rejected, test_name,
+                  "Check store stream 32-bit header overflow");
+  }
+
+  // Concurrent store stream
+  for (const auto order : std::vector<mtk::anns_dataset::append_order_t>{
+           mtk::anns_dataset::append_order_t::unordered,
+           mtk::anns_dataset::append_order_t::ordered}) {
+    const std::size_t num_split = 16;
+    const unsigned num_threads = 4;
+    std::vector<std::size_t> file_offset(num_split);
+    {
+      mtk::anns_dataset::concurrent_store_stream<data_t> ss(
+          file_name, dataset_dim, file_format, order);
+      std::vector<std::thread> threads;
+      for (unsigned t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+          for (std::size_t i = t; i < num_split; i += num_threads) {
+            const auto offset = i * dataset_size / num_split;
+            const auto size = (i + 1) * dataset_size / num_split - offset;
+            const auto src_ptr = src_dataset.data() + offset * src_dataset_ld;
+            if (order == mtk::anns_dataset::append_order_t::ordered) {
+              file_offset[i] = ss.append(i, src_ptr, src_dataset_ld, size);
+            } else {
+              file_offset[i] = ss.append(src_ptr, src_dataset_ld, size);
+            }
+          }
+        });
+      }
+      for (auto &t : threads) {
+        t.join();
+      }
+      ss.close();
+    }
+
+    const auto dataset_ld = dataset_dim;
+    std::vector<data_t> dataset(dataset_size * dataset_ld);
+    const auto res = mtk::anns_dataset::load(dataset.data(), file_name);
+
+    // check data
+    bool error = res != 0;
+    for (std::size_t s = 0; s < num_split; s++) {
+      const auto offset = s * dataset_size / num_split;
+      const auto size = (s + 1) * dataset_size / num_split - offset;
+      error = error ||
+              (order == mtk::anns_dataset::append_order_t::ordered &&
+               file_offset[s] != offset);
+      for (std::size_t i = 0; i < size; i++) {
+        for (std::uint32_t j = 0; j < dataset_dim; j++) {
+          error = error || (dataset[(file_offset[s] + i) * dataset_ld + j] !=
+                            src_dataset[(offset + i) * src_dataset_ld + j]);
+        }
+      }
+    }
+    EXPECTED_TRUE(!error, test_name,
+                  std::string("Check concurrent store stream (") +
+                      (order == mtk::anns_dataset::append_order_t::ordered
+                           ? "ordered"
+                           : "unordered") +
+                      ")");
+  }
+
+  // Store stream flush
+  {
+    mtk::anns_dataset::store_stream<data_t> ss(file_name, dataset_dim,
+                                               file_format);
+    ss.append(src_dataset.data(), src_dataset_ld, dataset_size / 2);
+    ss.flush();
+
+    const auto [dataset_size_load, dataset_dim_load] =
+        mtk::anns_dataset::load_size_info<data_t>(file_name);
+    EXPECTED_TRUE(dataset_size_load == dataset_size / 2 &&
+                      dataset_dim_load == dataset_dim,
+                  test_name, "Check dataset size after flush");
+  }
+
+  // Dataset file handle
+  {
+    mtk::anns_dataset::store(file_name, dataset_size, dataset_dim,
+                             src_dataset.data(), file_format);
+    const mtk::anns_dataset::dataset_file<data_t> file(file_name);
+
+    std::vector<data_t> dataset(dataset_size * dataset_dim);
+    bool error = file.size() != dataset_size || file.dim() != dataset_dim ||
+                 (file.format() & mtk::anns_dataset::format_t::FORMAT_MASK) !=
+                     file_format;
+    error = error || file.load(dataset.data(), 2) != 0 ||
+            dataset != src_dataset;
+
+    // Range
+    const auto offset = dataset_size / 3;
+    std::fill(dataset.begin(), dataset.end(), data_t(0));
+    error = error || file.load_range(dataset.data(),
+                                     mtk::anns_dataset::range_t{
+                                         .offset = offset, .size = 0}) != 0;
+    for (std::size_t i = 0; i < dataset_size - offset; i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        error = error || dataset[i * dataset_dim + j] !=
+                             src_dataset[(i + offset) * dataset_dim + j];
+      }
+    }
+
+    // Rows
+    const std::vector<std::uint32_t> ids = {
+        static_cast<std::uint32_t>(dataset_size - 1), 0, 1};
+    error = error ||
+            file.load_rows(dataset.data(), ids.data(), ids.size()) != 0;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      for (std::uint32_t j = 0; j < dataset_dim; j++) {
+        error = error || dataset[i * dataset_dim + j] !=
+                             src_dataset[ids[i] * dataset_dim + j];
+      }
+    }
+
+    // Stream
+    const auto stream = file.stream(dataset_size / 4 + 1);
+    std::size_t num_streamed = 0;
+    for (const auto &batch : *stream) {
+      error = error ||
+              std::memcmp(batch.data,
+                          src_dataset.data() + batch.offset * dataset_dim,
+                          batch.size * dataset_dim * sizeof(data_t)) != 0;
+      num_streamed += batch.size;
+    }
+    error = error || num_streamed != dataset_size;
+    EXPECTED_TRUE(!error, test_name, "Check dataset file handle");
+  }
+
+  // Sidecar metadata
+  {
+    mtk::anns_dataset::store(file_name, dataset_size, dataset_dim,
+                             src_dataset.data(), file_format, false, true);
+    mtk::anns_dataset::layout_t meta_layout;
+    const auto meta_valid =
+        mtk::anns_dataset::load_metadata<data_t>(file_name, meta_layout);
+
+    std::ifstream ifs(file_name);
+    const auto layout = mtk::anns_dataset::load_layout<data_t>(ifs);
+    ifs.close();
+
+    std::vector<data_t> dataset(dataset_size * dataset_dim);
+    const auto res = mtk::anns_dataset::load(dataset.data(), file_name);
+    EXPECTED_TRUE(meta_valid && res == 0 && dataset == src_dataset &&
+                      meta_layout.format == layout.format &&
+                      meta_layout.num_data == layout.num_data &&
+                      meta_layout.data_dim == layout.data_dim &&
+                      meta_layout.data_offset == layout.data_offset &&
+                      meta_layout.row_stride == layout.row_stride &&
+                      meta_layout.file_size == layout.file_size,
+                  test_name, "Check sidecar metadata");
+
+    // The metadata must not be used once the file is modified
+    mtk::anns_dataset::store(file_name, dataset_size / 2, dataset_dim,
+                             src_dataset.data(), file_format);
+    const auto [dataset_size_load, dataset_dim_load] =
+        mtk::anns_dataset::load_size_info<data_t>(file_name);
+    EXPECTED_TRUE(
+        !mtk::anns_dataset::load_metadata<data_t>(file_name, meta_layout) &&
+            dataset_size_load == dataset_size / 2,
+        test_name, "Check stale sidecar metadata");
+    std::remove(mtk::anns_dataset::get_metadata_path(file_name).c_str());
   }
 }
 
@@ -169,6 +666,116 @@ void stats_test_core(const std::size_t dataset_size,
       dataset.data(), dataset_ld, dataset_size, dataset_dim, 40);
   num_passed_test++;
   num_processed_test++;
+
+  // Compare with a two-pass reference
+  const auto stats = mtk::anns_dataset::compute_dimensionwise_stats(
+      dataset.data(), dataset_ld, dataset_size, dataset_dim);
+  bool error = stats.num_data != dataset_size || stats.dim() != dataset_dim;
+  for (std::size_t j = 0; j < dataset_dim && !error; j++) {
+    double sum = 0, sq_sum = 0;
+    auto min = dataset[j], max = dataset[j];
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      sum += dataset[i * dataset_ld + j];
+      min = std::min(min, dataset[i * dataset_ld + j]);
+      max = std::max(max, dataset[i * dataset_ld + j]);
+    }
+    const auto mean = sum / dataset_size;
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      const auto d = dataset[i * dataset_ld + j] - mean;
+      sq_sum += d * d;
+    }
+    const auto var = sq_sum / (dataset_size - 1);
+    error = error || stats.min[j] != min || stats.max[j] != max ||
+            std::abs(stats.mean[j] - mean) > 1e-9 * std::abs(mean) + 1e-12 ||
+            std::abs(stats.var[j] - var) > 1e-9 * var;
+  }
+  EXPECTED_TRUE(!error,
+                "Shape=" + std::to_string(dataset_dim) + "x" +
+                    std::to_string(dataset_size) + ", DataT=" +
+                    to_str<data_t>(),
+                "Check dimensionwise stats");
+
+  // From a file
+  {
+    mtk::anns_dataset::store_stream<data_t> ss(
+        "dataset.dat", dataset_dim,
+        mtk::anns_dataset::format_t::FORMAT_VECS);
+    ss.append(dataset.data(), dataset_ld, dataset_size);
+  }
+  const auto file_stats = mtk::anns_dataset::compute_dimensionwise_stats<
+      data_t>("dataset.dat", 1, 3, 333);
+  const auto sampled_stats = mtk::anns_dataset::compute_dimensionwise_stats<
+      data_t>("dataset.dat", 0.5, 3);
+  error = file_stats.num_data != dataset_size ||
+          sampled_stats.num_data != dataset_size / 2;
+  for (std::size_t j = 0; j < dataset_dim; j++) {
+    error = error || file_stats.min[j] != stats.min[j] ||
+            file_stats.max[j] != stats.max[j] ||
+            std::abs(file_stats.mean[j] - stats.mean[j]) >
+                1e-9 * std::abs(stats.mean[j]) + 1e-12 ||
+            std::abs(file_stats.var[j] - stats.var[j]) > 1e-9 * stats.var[j];
+  }
+  EXPECTED_TRUE(!error,
+                "Shape=" + std::to_string(dataset_dim) + "x" +
+                    std::to_string(dataset_size) + ", DataT=" +
+                    to_str<data_t>(),
+                "Check dimensionwise stats of a file");
+
+  // Histograms
+  const std::size_t num_bins = 7;
+  const auto histogram = mtk::anns_dataset::compute_dimensionwise_histogram(
+      dataset.data(), dataset_ld, dataset_size, num_bins, stats);
+  const auto file_histogram =
+      mtk::anns_dataset::compute_dimensionwise_histogram<data_t>(
+          "dataset.dat", num_bins, stats, 1, 3, 333);
+  error = histogram.counts != file_histogram.counts;
+  for (std::size_t j = 0; j < dataset_dim; j++) {
+    std::vector<std::uint64_t> counts(num_bins);
+    for (std::size_t i = 0; i < dataset_size; i++) {
+      const double v = dataset[i * dataset_ld + j];
+      counts[std::min<std::size_t>(num_bins - 1,
+                                   (v - stats.min[j]) /
+                                       (stats.max[j] - stats.min[j]) *
+                                       num_bins)]++;
+    }
+    for (std::size_t b = 0; b < num_bins; b++) {
+      error = error || histogram.count(j, b) != counts[b];
+    }
+  }
+  EXPECTED_TRUE(!error,
+                "Shape=" + std::to_string(dataset_dim) + "x" +
+                    std::to_string(dataset_size) + ", DataT=" +
+                    to_str<data_t>(),
+                "Check dimensionwise histograms");
+
+  // Quantile sketches. The rank of each quantile must be close to q
+  const auto sketches =
+      mtk::anns_dataset::compute_dimensionwise_quantile_sketch(
+          dataset.data(), dataset_ld, dataset_size, dataset_dim);
+  const auto file_sketches =
+      mtk::anns_dataset::compute_dimensionwise_quantile_sketch<data_t>(
+          "dataset.dat", 200, 1, 3, 333);
+  error = false;
+  for (const auto q : {0.01, 0.5, 0.99}) {
+    for (const auto &s : {&sketches, &file_sketches}) {
+      const auto quantiles = mtk::anns_dataset::get_quantiles(*s, q);
+      for (std::size_t j = 0; j < dataset_dim; j++) {
+        std::size_t num_less = 0, num_less_equal = 0;
+        for (std::size_t i = 0; i < dataset_size; i++) {
+          num_less += dataset[i * dataset_ld + j] < quantiles[j];
+          num_less_equal += dataset[i * dataset_ld + j] <= quantiles[j];
+        }
+        error = error || (*s)[j].count() != dataset_size ||
+                num_less > (q + 0.03) * dataset_size ||
+                num_less_equal < (q - 0.03) * dataset_size;
+      }
+    }
+  }
+  EXPECTED_TRUE(!error,
+                "Shape=" + std::to_string(dataset_dim) + "x" +
+                    std::to_string(dataset_size) + ", DataT=" +
+                    to_str<data_t>(),
+                "Check dimensionwise quantile sketches");
 }
 
 template <class data_t> void stats_test() {
@@ -180,6 +787,505 @@ template <class data_t> void stats_test() {
   }
 }
 
+template <class data_t>
+void pca_test_core(const std::size_t dataset_size,
+                   const std::size_t dataset_dim) {
+  const std::string shape_str = "Shape=" + std::to_string(dataset_dim) + "x" +
+                                std::to_string(dataset_size) +
+                                ", DataT=" + to_str<data_t>();
+  // Correlated dimensions
+  const std::size_t dataset_ld = dataset_dim + 1;
+  std::vector<data_t> dataset(dataset_size * dataset_ld);
+  std::uint64_t state = 1;
+  for (std::size_t i = 0; i < dataset_size; i++) {
+    int prev = 0;
+    for (std::size_t j = 0; j < dataset_dim; j++) {
+      state = state * 6364136223846793005lu + 1442695040888963407lu;
+      const int v = static_cast<int>((state >> 33) % 41) + prev / 2;
+      dataset[i * dataset_ld + j] = v;
+      prev = v;
+    }
+  }
+
+  // Compare with a two-pass reference
+  const auto covariance = mtk::anns_dataset::compute_covariance(
+      dataset.data(), dataset_ld, dataset_size, dataset_dim);
+  std::vector<double> mean(dataset_dim, 0);
+  for (std::size_t i = 0; i < dataset_size; i++) {
+    for (std::size_t j = 0; j < dataset_dim; j++) {
+      mean[j] += dataset[i * dataset_ld + j];
+    }
+  }
+  for (auto &m : mean) {
+    m /= dataset_size;
+  }
+  bool error = covariance.num_data != dataset_size ||
+               covariance.dim() != dataset_dim;
+  for (std::size_t j = 0; j < dataset_dim && !error; j++) {
+    error = std::abs(covariance.mean[j] - mean[j]) > 1e-9 * mean[j];
+    for (std::size_t k = 0; k < dataset_dim; k++) {
+      double sum = 0;
+      for (std::size_t i = 0; i < dataset_size; i++) {
+        sum += (dataset[i * dataset_ld + j] - mean[j]) *
+               (dataset[i * dataset_ld + k] - mean[k]);
+      }
+      const auto cov = sum / (dataset_size - 1);
+      error = error || std::abs(covariance.cov[j * dataset_dim + k] - cov) >
+                           1e-9 * (std::abs(cov) + 1);
+    }
+  }
+  EXPECTED_TRUE(!error, shape_str, "Check covariance");
+
+  // From a file
+  {
+    mtk::anns_dataset::store_stream<data_t> ss(
+        "dataset.dat", dataset_dim,
+        mtk::anns_dataset::format_t::FORMAT_VECS);
+    ss.append(dataset.data(), dataset_ld, dataset_size);
+  }
+  const auto file_covariance =
+      mtk::anns_dataset::compute_covariance<data_t>("dataset.dat", 1, 3, 333);
+  error = file_covariance.num_data != dataset_size;
+  for (std::size_t j = 0; j < dataset_dim * dataset_dim; j++) {
+    error = error || std::abs(file_covariance.cov[j] - covariance.cov[j]) >
+                         1e-9 * (std::abs(covariance.cov[j]) + 1);
+  }
+  EXPECTED_TRUE(!error, shape_str, "Check covariance of a file");
+
+  // Eigen decomposition: A v = l v and orthonormality
+  const auto eigen =
+      mtk::anns_dataset::eigen_decomposition(covariance.cov, dataset_dim);
+  error = false;
+  for (std::size_t k = 0; k < dataset_dim; k++) {
+    const auto v = eigen.vectors.data() + k * dataset_dim;
+    for (std::size_t i = 0; i < dataset_dim; i++) {
+      double av = 0;
+      for (std::size_t j = 0; j < dataset_dim; j++) {
+        av += covariance.cov[i * dataset_dim + j] * v[j];
+      }
+      error = error || std::abs(av - eigen.values[k] * v[i]) >
+                           1e-8 * eigen.values[0];
+    }
+    for (std::size_t l = 0; l <= k; l++) {
+      double dot = 0;
+      for (std::size_t j = 0; j < dataset_dim; j++) {
+        dot += v[j] * eigen.vectors[l * dataset_dim + j];
+      }
+      error = error || std::abs(dot - (k == l ? 1 : 0)) > 1e-10;
+    }
+    error = error || (k > 0 && eigen.values[k] > eigen.values[k - 1]);
+  }
+  EXPECTED_TRUE(!error, shape_str, "Check eigen decomposition");
+
+  // Top eigenpairs by the power iteration
+  const std::size_t num_components = 3;
+  const auto top = mtk::anns_dataset::power_iteration(
+      covariance.cov, dataset_dim, num_components);
+  error = false;
+  for (std::size_t k = 0; k < num_components; k++) {
+    double dot = 0;
+    for (std::size_t j = 0; j < dataset_dim; j++) {
+      dot += top.vectors[k * dataset_dim + j] *
+             eigen.vectors[k * dataset_dim + j];
+    }
+    error = error ||
+            std::abs(top.values[k] - eigen.values[k]) >
+                1e-6 * eigen.values[0] ||
+            std::abs(std::abs(dot) - 1) > 1e-4;
+  }
+  EXPECTED_TRUE(!error, shape_str, "Check power iteration");
+
+  // Whitened rotation of the file
+  const auto pca = mtk::anns_dataset::compute_pca(file_covariance, 0, true);
+  const auto res = mtk::anns_dataset::apply_pca<data_t>(
+      "dataset.dat", "rotated.dat", pca,
+      mtk::anns_dataset::format_t::FORMAT_BIGANN, 333);
+  std::vector<float> rotated(dataset_size * dataset_dim);
+  mtk::anns_dataset::apply_pca(rotated.data(), dataset_dim, dataset.data(),
+                               dataset_ld, dataset_size, pca);
+  std::vector<float> loaded(dataset_size * dataset_dim);
+  mtk::anns_dataset::load(loaded.data(), "rotated.dat", false);
+  const auto rotated_covariance = mtk::anns_dataset::compute_covariance(
+      loaded.data(), dataset_dim, dataset_size, dataset_dim);
+  error = res != 0 || loaded != rotated;
+  for (std::size_t j = 0; j < dataset_dim; j++) {
+    error = error || std::abs(rotated_covariance.mean[j]) > 1e-3;
+    for (std::size_t k = 0; k < dataset_dim; k++) {
+      error = error ||
+              std::abs(rotated_covariance.cov[j * dataset_dim + k] -
+                       (j == k ? 1 : 0)) > 1e-3;
+    }
+  }
+  EXPECTED_TRUE(!error, shape_str, "Check PCA rotation");
+  std::remove("rotated.dat");
+}
+
+template <class data_t> void pca_test() {
+  for (const auto &dataset_shape :
+       std::vector<std::pair<std::uint32_t, std::size_t>>{{15u, 1000lu},
+                                                          {70u, 3000lu}}) {
+    pca_test_core<data_t>(std::get<1>(dataset_shape),
+                          std::get<0>(dataset_shape));
+  }
+}
+
+template <class DST_T, class SRC_T>
+void convert_test_core(const std::vector<SRC_T> &src) {
+  const std::string test_name = "Convert " + std::to_string(sizeof(SRC_T)) +
+                                "B -> " + std::to_string(sizeof(DST_T)) + "B";
+  for (const auto n : std::vector<std::size_t>{0, 1, 7, 8, 15, 16, 17, 33,
+                                               src.size()}) {
+    std::vector<DST_T> dst(n), ref(n);
+    mtk::anns_dataset::detail::convert(dst.data(), src.data(), n);
+    for (std::size_t i = 0; i < n; i++) {
+      ref[i] = static_cast<DST_T>(src[i]);
+    }
+    EXPECTED_TRUE(std::memcmp(dst.data(), ref.data(), sizeof(DST_T) * n) == 0,
+                  test_name, "Check conversion kernel (n=" +
+                                 std::to_string(n) + ")");
+  }
+}
+
+void convert_test() {
+  std::vector<std::uint8_t> u8(1000);
+  std::vector<std::int8_t> i8(1000);
+  std::vector<float> f32(1000);
+  for (std::size_t i = 0; i < f32.size(); i++) {
+    u8[i] = (i * 7) % 256;
+    i8[i] = static_cast<std::int8_t>((i * 7) % 256);
+    f32[i] = (static_cast<float>(i) - 500) * 1.37e-3f * (i % 13 + 1);
+  }
+  // Special values
+  f32[1] = std::numeric_limits<float>::infinity();
+  f32[2] = -std::numeric_limits<float>::infinity();
+  f32[3] = std::numeric_limits<float>::quiet_NaN();
+  f32[4] = 1e-7f;
+  f32[5] = 65520.f;
+  f32[6] = -0.f;
+  f32[9] = 1.00048828125f;
+
+  convert_test_core<float>(u8);
+  convert_test_core<float>(i8);
+  convert_test_core<std::int16_t>(i8);
+  convert_test_core<std::int32_t>(i8);
+  convert_test_core<mtk::anns_dataset::float16_t>(f32);
+  convert_test_core<mtk::anns_dataset::bfloat16_t>(f32);
+
+  std::vector<mtk::anns_dataset::float16_t> f16(f32.size());
+  std::vector<mtk::anns_dataset::bfloat16_t> bf16(f32.size());
+  mtk::anns_dataset::detail::convert(f16.data(), f32.data(), f32.size());
+  mtk::anns_dataset::detail::convert(bf16.data(), f32.data(), f32.size());
+  convert_test_core<float>(f16);
+  convert_test_core<float>(bf16);
+
+  const std::string test_name = "Convert FP16";
+  const auto h = static_cast<mtk::anns_dataset::float16_t>(f32[9]);
+  EXPECTED_TRUE(h.data == 0x3c00 && static_cast<float>(h) == 1.f, test_name,
+                "Check round to nearest even");
+  EXPECTED_TRUE(static_cast<mtk::anns_dataset::float16_t>(f32[5]).data ==
+                    0x7c00,
+                test_name, "Check overflow");
+  EXPECTED_TRUE(static_cast<float>(
+                    static_cast<mtk::anns_dataset::float16_t>(6e-5f)) ==
+                    static_cast<float>(
+                        mtk::anns_dataset::float16_t(6.0e-5)),
+                test_name, "Check subnormal");
+}
+
+template <class FILE_T>
+void half_test_core(const mtk::anns_dataset::format_t file_format) {
+  const std::string test_name =
+      "Shape=33x1000, DataT=" + mtk::anns_dataset::get_type_str<FILE_T>() +
+      ", Fmt=" + mtk::anns_dataset::get_format_str(file_format);
+  const std::string file_name = "dataset.dat";
+  const std::size_t dataset_size = 1000;
+  const std::size_t dataset_dim = 33;
+
+  std::vector<float> src_dataset(dataset_size * dataset_dim);
+  std::vector<float> ref_dataset(src_dataset.size());
+  for (std::size_t i = 0; i < src_dataset.size(); i++) {
+    src_dataset[i] = (static_cast<float>(i % 997) - 498) * 1.1e-2f;
+    ref_dataset[i] = static_cast<float>(FILE_T(src_dataset[i]));
+  }
+
+  // Stored from float with rounding
+  mtk::anns_dataset::store<FILE_T>(file_name, dataset_size, dataset_dim,
+                                   src_dataset.data(), file_format);
+
+  const auto [dataset_size_load, dataset_dim_load] =
+      mtk::anns_dataset::load_size_info<FILE_T>(file_name);
+  EXPECTED_TRUE(dataset_size_load == dataset_size &&
+                    dataset_dim_load == dataset_dim,
+                test_name, "Check dataset size of loaded dataset");
+
+  std::vector<float> dataset(dataset_size * dataset_dim);
+  const auto res =
+      mtk::anns_dataset::load<float, FILE_T>(dataset.data(), file_name);
+  EXPECTED_TRUE(res == 0 && dataset == ref_dataset, test_name,
+                "Check loaded data");
+
+  std::fill(dataset.begin(), dataset.end(), 0.f);
+  const auto res_parallel = mtk::anns_dataset::load_parallel<float, FILE_T>(
+      dataset.data(), file_name, 4);
+  EXPECTED_TRUE(res_parallel == 0 && dataset == ref_dataset, test_name,
+                "Check loaded data (parallel)");
+}
+
+void half_test() {
+  for (const auto &format : std::vector<mtk::anns_dataset::format_t>{
+           mtk::anns_dataset::format_t::FORMAT_BIGANN,
+           mtk::anns_dataset::format_t::FORMAT_VECS}) {
+    half_test_core<mtk::anns_dataset::float16_t>(format);
+    half_test_core<mtk::anns_dataset::bfloat16_t>(format);
+  }
+}
+
+template <class Q>
+void sq8_test_core(const mtk::anns_dataset::format_t format) {
+  const std::string test_name =
+      "Shape=37x3000, DataT=" + mtk::anns_dataset::get_type_str<Q>() +
+      ", Fmt=" + mtk::anns_dataset::get_format_str(format);
+  const std::string src_name = "dataset.dat";
+  const std::string dst_name = "dataset.sq8.dat";
+  const std::size_t dataset_size = 3000;
+  const std::size_t dataset_dim = 37;
+
+  std::vector<float> src_dataset(dataset_size * dataset_dim);
+  for (std::size_t i = 0; i < dataset_size; i++) {
+    for (std::size_t j = 0; j < dataset_dim; j++) {
+      src_dataset[i * dataset_dim + j] =
+          std::sin(static_cast<float>(i * 13 + j)) * (j + 1) - j;
+    }
+  }
+  mtk::anns_dataset::store(src_name, dataset_size, dataset_dim,
+                           src_dataset.data(), format);
+
+  const auto res = mtk::anns_dataset::quantize_sq8<Q>(src_name, dst_name,
+                                                      format, 0, 3, 1000);
+  mtk::anns_dataset::sq_params_t params;
+  EXPECTED_TRUE(res == 0 && mtk::anns_dataset::load_sq_params(dst_name,
+                                                              params) &&
+                    params.dim() == dataset_dim,
+                test_name, "Check SQ8 quantization");
+
+  // The error is at most a half step of each dimension
+  const auto check = [&](const std::vector<float> &dataset,
+                         const std::size_t offset, const std::size_t size) {
+    bool error = false;
+    for (std::size_t i = 0; i < size; i++) {
+      for (std::size_t j = 0; j < dataset_dim; j++) {
+        error = error || std::abs(dataset[i * dataset_dim + j] -
+                                  src_dataset[(offset + i) * dataset_dim + j]) >
+                             params.scale[j] * 0.501f;
+      }
+    }
+    return !error;
+  };
+
+  std::vector<float> dataset(dataset_size * dataset_dim);
+  EXPECTED_TRUE(mtk::anns_dataset::load(dataset.data(), dst_name) == 0 &&
+                    check(dataset, 0, dataset_size),
+                test_name, "Check SQ8 dequantized load");
+
+  // The size queries see the 8-bit file. Raw float readers reject it.
+  const auto [num_data, data_dim] =
+      mtk::anns_dataset::load_size_info<float>(dst_name);
+  bool rejected = false;
+  try {
+    mtk::anns_dataset::dataset_file<float> file(dst_name);
+  } catch (const std::exception &) {
+    rejected = true;
+  }
+  EXPECTED_TRUE(num_data == dataset_size && data_dim == dataset_dim &&
+                    rejected,
+                test_name, "Check SQ8 size info");
+
+  std::fill(dataset.begin(), dataset.end(), 0.f);
+  const mtk::anns_dataset::range_t range{.offset = 100, .size = 1000};
+  EXPECTED_TRUE(mtk::anns_dataset::load_parallel(dataset.data(), dst_name, 4,
+                                                 false, format, range) == 0 &&
+                    check(dataset, range.offset, range.size),
+                test_name, "Check SQ8 dequantized parallel load");
+
+  const mtk::anns_dataset::range_t out_of_range{.offset = dataset_size + 1,
+                                                .size = 0};
+  EXPECTED_TRUE(mtk::anns_dataset::load_parallel(dataset.data(), dst_name, 4,
+                                                 false, format,
+                                                 out_of_range) != 0,
+                test_name, "Check SQ8 out of range load");
+  EXPECTED_TRUE(
+      mtk::anns_dataset::load(
+          dataset.data(), dst_name, false, format,
+          mtk::anns_dataset::range_t{.offset = 0, .size = 0}, false, 0, 0.f,
+          mtk::anns_dataset::projection_t::window(dataset_dim + 5, 0)) != 0,
+      test_name, "Check SQ8 out of range projection load");
+
+  // The parameters are stale once the file is rewritten with the same size
+  {
+    std::vector<Q> quantized(dataset_size * dataset_dim);
+    mtk::anns_dataset::load(quantized.data(), dst_name);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mtk::anns_dataset::store(dst_name, dataset_size, dataset_dim,
+                             quantized.data(), format);
+    EXPECTED_TRUE(!mtk::anns_dataset::load_sq_params(dst_name, params),
+                  test_name, "Check stale SQ8 parameters");
+  }
+
+  // Clipped range
+  mtk::anns_dataset::quantize_sq8<Q>(src_name, dst_name, format, 0.05, 3);
+  bool error = mtk::anns_dataset::load(dataset.data(), dst_name) != 0 ||
+               !mtk::anns_dataset::load_sq_params(dst_name, params);
+  std::size_t num_clipped = 0;
+  for (std::size_t i = 0; i < dataset_size * dataset_dim; i++) {
+    const auto j = i % dataset_dim;
+    const auto q_lowest = std::numeric_limits<Q>::lowest();
+    const auto q_max = std::numeric_limits<Q>::max();
+    const auto lo = params.scale[j] * q_lowest + params.offset[j];
+    const auto hi = params.scale[j] * q_max + params.offset[j];
+    num_clipped += src_dataset[i] < lo - 1e-4f || src_dataset[i] > hi + 1e-4f;
+    error = error || dataset[i] < lo - 1e-4f || dataset[i] > hi + 1e-4f;
+  }
+  EXPECTED_TRUE(!error && num_clipped > 0 &&
+                    num_clipped < dataset_size * dataset_dim * 0.2,
+                test_name, "Check SQ8 clipped quantization");
+
+  std::remove(mtk::anns_dataset::get_sq_params_path(dst_name).c_str());
+  std::remove(dst_name.c_str());
+}
+
+void sq8_test() {
+  for (const auto &format : std::vector<mtk::anns_dataset::format_t>{
+           mtk::anns_dataset::format_t::FORMAT_BIGANN,
+           mtk::anns_dataset::format_t::FORMAT_VECS}) {
+    sq8_test_core<std::int8_t>(format);
+    sq8_test_core<std::uint8_t>(format);
+  }
+}
+
+// Counts the callbacks and keeps the final metrics
+class counting_observer : public mtk::anns_dataset::io_observer {
+public:
+  std::size_t num_progress = 0;
+  std::size_t num_complete = 0;
+  mtk::anns_dataset::io_metrics_t metrics;
+
+  counting_observer() { progress_interval = std::chrono::nanoseconds(0); }
+  void on_progress(const mtk::anns_dataset::io_metrics_t &) override {
+    num_progress++;
+  }
+  void on_complete(const mtk::anns_dataset::io_metrics_t &m) override {
+    num_complete++;
+    metrics = m;
+  }
+};
+
+void observer_test_core(const mtk::anns_dataset::format_t format) {
+  const std::string test_name =
+      "Fmt=" + mtk::anns_dataset::get_format_str(format);
+  const std::size_t dataset_size = 100000;
+  const std::size_t dataset_dim = 33;
+  std::vector<std::uint8_t> dataset(dataset_size * dataset_dim);
+  for (std::size_t i = 0; i < dataset.size(); i++) {
+    dataset[i] = i * 7;
+  }
+
+  counting_observer store_observer;
+  mtk::anns_dataset::store("dataset.dat", dataset_size, dataset_dim,
+                           dataset.data(), format, false, false,
+                           &store_observer);
+  const auto layout =
+      mtk::anns_dataset::load_layout<std::uint8_t>("dataset.dat");
+  // The BIGANN header is written twice (on open and on close)
+  const auto header_bytes =
+      format == mtk::anns_dataset::format_t::FORMAT_BIGANN ? layout.data_offset
+                                                           : 0;
+  EXPECTED_TRUE(store_observer.num_complete == 1 &&
+                    store_observer.num_progress > 0 &&
+                    store_observer.metrics.num_done == dataset_size &&
+                    store_observer.metrics.bytes_written ==
+                        layout.file_size + header_bytes,
+                test_name, "Check store metrics");
+
+  std::vector<float> loaded(dataset_size * dataset_dim);
+  counting_observer load_observer;
+  const mtk::anns_dataset::range_t range{.offset = 100, .size = 50000};
+  mtk::anns_dataset::load_parallel<float, std::uint8_t>(
+      loaded.data(), "dataset.dat", 3, false, format, range, false, 0, 0.f,
+      &load_observer);
+  EXPECTED_TRUE(load_observer.num_complete == 1 &&
+                    load_observer.metrics.num_done == range.size &&
+                    load_observer.metrics.bytes_read ==
+                        range.size * layout.row_stride &&
+                    load_observer.metrics.num_read_calls > 0 &&
+                    loaded[0] == dataset[range.offset * dataset_dim],
+                test_name, "Check load_parallel metrics");
+
+  counting_observer ifs_observer;
+  mtk::anns_dataset::load<float, std::uint8_t>(
+      loaded.data(), "dataset.dat", false, format, range, false, 0, 0.f, {},
+      &ifs_observer);
+  EXPECTED_TRUE(ifs_observer.num_complete == 1 &&
+                    ifs_observer.metrics.num_done == range.size &&
+                    ifs_observer.metrics.bytes_read ==
+                        range.size * layout.row_stride,
+                test_name, "Check load metrics");
+
+  // Identity SQ8 parameters make the float load dequantize the file
+  mtk::anns_dataset::sq_params_t params;
+  params.element_type = "U8";
+  params.scale.assign(dataset_dim, 1.f);
+  params.offset.assign(dataset_dim, 0.f);
+  mtk::anns_dataset::store_sq_params("dataset.dat", params);
+  counting_observer sq8_observer;
+  const auto res = mtk::anns_dataset::load_parallel(
+      loaded.data(), "dataset.dat", 3, false, format, range, true, 0, 0.f,
+      &sq8_observer);
+  std::remove(mtk::anns_dataset::get_sq_params_path("dataset.dat").c_str());
+  EXPECTED_TRUE(res == 0 && sq8_observer.num_complete == 1 &&
+                    sq8_observer.metrics.num_done == range.size &&
+                    sq8_observer.metrics.bytes_read ==
+                        range.size * layout.row_stride &&
+                    loaded[0] == dataset[range.offset * dataset_dim],
+                test_name, "Check SQ8 load metrics");
+
+  counting_observer stream_observer;
+  {
+    mtk::anns_dataset::load_stream<std::uint8_t> stream(
+        "dataset.dat", 999, format,
+        mtk::anns_dataset::range_t{.offset = 0, .size = 0}, false, 0, 0,
+        &stream_observer);
+    for (const auto &batch : stream) {
+      (void)batch;
+    }
+  }
+  EXPECTED_TRUE(stream_observer.num_complete == 1 &&
+                    stream_observer.metrics.num_done == dataset_size,
+                test_name, "Check load_stream metrics");
+
+  counting_observer quantize_observer;
+  const auto quantize_res =
+      mtk::anns_dataset::quantize_sq8<std::uint8_t, std::uint8_t>(
+          "dataset.dat", "dataset.sq8.dat", format, 0, 3, 999, false,
+          &quantize_observer);
+  std::remove(
+      mtk::anns_dataset::get_sq_params_path("dataset.sq8.dat").c_str());
+  std::remove("dataset.sq8.dat");
+  EXPECTED_TRUE(quantize_res == 0 && quantize_observer.num_complete == 1 &&
+                    quantize_observer.num_progress > 0 &&
+                    quantize_observer.metrics.num_done == dataset_size &&
+                    quantize_observer.metrics.bytes_written ==
+                        dataset_size * dataset_dim,
+                test_name, "Check quantize_sq8 metrics");
+}
+
+void observer_test() {
+  for (const auto format : std::vector<mtk::anns_dataset::format_t>{
+           mtk::anns_dataset::format_t::FORMAT_BIGANN,
+           mtk::anns_dataset::format_t::FORMAT_VECS}) {
+    observer_test_core(format);
+  }
+}
+
 int main() {
   test<float, std::uint32_t>();
   test<float, std::uint64_t>();
@@ -187,9 +1293,18 @@ int main() {
   test<std::uint8_t, std::uint64_t>();
   test<std::int8_t, std::uint32_t>();
   test<std::int8_t, std::uint64_t>();
+  convert_test();
+  half_test();
+  sq8_test();
+#ifndef ANNS_DATASET_DISABLE_OBSERVER
+  observer_test();
+#endif
   stats_test<float>();
   stats_test<std::int8_t>();
   stats_test<std::uint8_t>();
+  pca_test<float>();
+  pca_test<std::int8_t>();
+  pca_test<std::uint8_t>();
   std::printf("%5u / %5u PASSED\n", num_passed_test, num_processed_test);
   if (!failed_test_list.empty()) {
     std::printf("FAILED TEST(S)\n");
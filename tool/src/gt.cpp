@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <anns_dataset.hpp>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <omp.h>
+#include <vector>
+
+namespace {
+enum class metric_t { l2, ip };
+
+// 8-bit vectors are compared in int32 without widening them in memory
+template <class T> struct accumulator { using type = float; };
+template <> struct accumulator<std::int8_t> { using type = std::int32_t; };
+template <> struct accumulator<std::uint8_t> { using type = std::int32_t; };
+
+// Queries and base vectors compared per tile so that a base tile is reused
+// from cache by all queries of a query tile
+constexpr std::size_t query_tile_size = 8;
+constexpr std::size_t base_tile_size = 128;
+
+// Smaller is closer. The inner product is negated.
+template <metric_t METRIC, class T>
+inline typename accumulator<T>::type
+get_key(const T *const a, const T *const b, const std::size_t dim) {
+  using acc_t = typename accumulator<T>::type;
+  acc_t sum = 0;
+  if constexpr (METRIC == metric_t::l2) {
+#pragma omp simd reduction(+ : sum)
+    for (std::size_t i = 0; i < dim; i++) {
+      const auto d = static_cast<acc_t>(a[i]) - static_cast<acc_t>(b[i]);
+      sum += d * d;
+    }
+    return sum;
+  } else {
+#pragma omp simd reduction(+ : sum)
+    for (std::size_t i = 0; i < dim; i++) {
+      sum += static_cast<acc_t>(a[i]) * static_cast<acc_t>(b[i]);
+    }
+    return -sum;
+  }
+}
+
+// The k nearest neighbors of a query. The farthest one is at the front.
+template <class KEY_T> class top_k {
+  std::size_t k;
+  std::vector<std::pair<KEY_T, std::uint32_t>> heap;
+
+public:
+  explicit top_k(const std::size_t k = 0) : k(k) { heap.reserve(k); }
+
+  inline void push(const KEY_T key, const std::uint32_t id) {
+    const auto item = std::make_pair(key, id);
+    if (heap.size() < k) {
+      heap.push_back(item);
+      std::push_heap(heap.begin(), heap.end());
+    } else if (item < heap.front()) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = item;
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+
+  // Nearest first. Ties are ordered by the id.
+  inline std::vector<std::pair<KEY_T, std::uint32_t>> get_sorted() const {
+    auto sorted = heap;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  }
+};
+
+template <metric_t METRIC, class T>
+void search_batch(std::vector<top_k<typename accumulator<T>::type>> &result,
+                  const T *const queries, const std::size_t num_queries,
+                  const T *const base, const std::size_t base_ld,
+                  const std::size_t base_offset, const std::size_t num_base,
+                  const std::size_t dim, const unsigned num_threads) {
+  const auto num_query_tiles =
+      (num_queries + query_tile_size - 1) / query_tile_size;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+  for (std::size_t qt = 0; qt < num_query_tiles; qt++) {
+    const auto q0 = qt * query_tile_size;
+    const auto q1 = std::min(num_queries, q0 + query_tile_size);
+    for (std::size_t b0 = 0; b0 < num_base; b0 += base_tile_size) {
+      const auto b1 = std::min(num_base, b0 + base_tile_size);
+      for (std::size_t q = q0; q < q1; q++) {
+        const auto query = queries + q * dim;
+        for (std::size_t b = b0; b < b1; b++) {
+          result[q].push(get_key<METRIC>(query, base + b * base_ld, dim),
+                         base_offset + b);
+        }
+      }
+    }
+  }
+}
+
+template <class KEY_T>
+float get_distance(const KEY_T key, const metric_t metric) {
+  return metric == metric_t::ip ? -static_cast<float>(key)
+                                : static_cast<float>(key);
+}
+
+template <class KEY_T>
+int write_result(const std::vector<top_k<KEY_T>> &result, const std::size_t k,
+                 const metric_t metric, const std::string output_path,
+                 const std::string distance_path, const bool bigann) {
+  const auto num_queries = result.size();
+  std::vector<std::uint32_t> ids(num_queries * k,
+                                 std::numeric_limits<std::uint32_t>::max());
+  std::vector<float> distances(num_queries * k,
+                               std::numeric_limits<float>::infinity());
+  for (std::size_t q = 0; q < num_queries; q++) {
+    const auto sorted = result[q].get_sorted();
+    for (std::size_t i = 0; i < sorted.size(); i++) {
+      ids[q * k + i] = sorted[i].second;
+      distances[q * k + i] = get_distance(sorted[i].first, metric);
+    }
+  }
+
+  if (bigann) {
+    // Header (num_queries, k), ids and then distances
+    std::ofstream ofs(output_path, std::ios::binary);
+    mtk::anns_dataset::store_stream<std::uint32_t> ss(
+        ofs, k, mtk::anns_dataset::format_t::FORMAT_BIGANN);
+    ss.append(ids.data(), k, num_queries);
+    ss.close();
+    ofs.write(reinterpret_cast<const char *>(distances.data()),
+              distances.size() * sizeof(float));
+    if (!ofs) {
+      std::fprintf(stderr, "[gt] Failed to write %s\n", output_path.c_str());
+      return 1;
+    }
+    return 0;
+  }
+
+  mtk::anns_dataset::store(output_path, num_queries, k, ids.data(),
+                           mtk::anns_dataset::format_t::FORMAT_VECS);
+  if (!distance_path.empty()) {
+    mtk::anns_dataset::store(distance_path, num_queries, k, distances.data(),
+                             mtk::anns_dataset::format_t::FORMAT_VECS);
+  }
+  return 0;
+}
+
+template <class T>
+int gt_core(const std::string base_path, const std::string query_path,
+            const std::size_t k, const std::string output_path,
+            const std::string distance_path, const metric_t metric,
+            const bool bigann, unsigned num_threads,
+            const std::size_t batch_size) {
+  using key_t = typename accumulator<T>::type;
+  if (num_threads == 0) {
+    num_threads = omp_get_max_threads();
+  }
+
+  std::vector<T> queries;
+  std::size_t num_queries, dim;
+  try {
+    const mtk::anns_dataset::dataset_file<T> query_file(query_path);
+    num_queries = query_file.size();
+    dim = query_file.dim();
+    queries.resize(num_queries * dim);
+    if (query_file.load(queries.data(), num_threads)) {
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[gt] Invalid query file %s (%s)\n",
+                 query_path.c_str(), e.what());
+    return 1;
+  }
+
+  const auto start_clock = std::chrono::system_clock::now();
+  std::vector<top_k<key_t>> result(num_queries, top_k<key_t>(k));
+  try {
+    mtk::anns_dataset::load_stream<T> base(base_path, batch_size);
+    if (base.dim() != dim) {
+      std::fprintf(stderr,
+                   "[gt] Inconsistent dataset dim. base = %zu v.s. query = "
+                   "%zu\n",
+                   base.dim(), dim);
+      return 1;
+    }
+    if (base.size() > std::numeric_limits<std::uint32_t>::max()) {
+      std::fprintf(stderr, "[gt] Too many base vectors for 32-bit ids\n");
+      return 1;
+    }
+    if (std::is_integral<T>::value && dim > (1lu << 31) / (255 * 255)) {
+      std::fprintf(stderr, "[gt] Too large dim for 32-bit accumulation\n");
+      return 1;
+    }
+    std::printf("[gt] Base   : %s [size=%zu, dim=%zu]\n", base_path.c_str(),
+                base.size(), dim);
+    std::printf("[gt] Query  : %s [size=%zu]\n", query_path.c_str(),
+                num_queries);
+    std::printf("[gt] k = %zu, metric = %s, threads = %u\n", k,
+                metric == metric_t::l2 ? "L2" : "IP", num_threads);
+
+    for (const auto &batch : base) {
+      if (metric == metric_t::l2) {
+        search_batch<metric_t::l2>(result, queries.data(), num_queries,
+                                   batch.data, base.ld(), batch.offset,
+                                   batch.size, dim, num_threads);
+      } else {
+        search_batch<metric_t::ip>(result, queries.data(), num_queries,
+                                   batch.data, base.ld(), batch.offset,
+                                   batch.size, dim, num_threads);
+      }
+      std::printf("[gt] Searching... (%4.2f %%)\r",
+                  (batch.offset + batch.size) * 100. / base.size());
+      std::fflush(stdout);
+    }
+    std::printf("\n");
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[gt] Invalid base file %s (%s)\n", base_path.c_str(),
+                 e.what());
+    return 1;
+  }
+  const auto end_clock = std::chrono::system_clock::now();
+  const auto elapsed_time =
+      std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
+                                                            start_clock)
+          .count() *
+      1e-6;
+  std::printf("[gt] Done [%.3fs]\n", elapsed_time);
+
+  std::printf("[gt] Output : %s (%s)\n", output_path.c_str(),
+              bigann ? "BIGANN" : "ivecs");
+  try {
+    return write_result(result, k, metric, output_path, distance_path, bigann);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[gt] Failed to write %s (%s)\n",
+                 output_path.c_str(), e.what());
+    return 1;
+  }
+}
+} // unnamed namespace
+
+int main(int argc, char **argv) {
+  metric_t metric = metric_t::l2;
+  bool bigann = false;
+  unsigned num_threads = 0;
+  std::size_t batch_size = 1lu << 18;
+  std::string distance_path;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::string metric_opt = "--metric=";
+    const std::string threads_opt = "--threads=";
+    const std::string batch_opt = "--batch-size=";
+    const std::string distance_opt = "--distances=";
+    if (arg.compare(0, metric_opt.size(), metric_opt) == 0) {
+      const auto m = arg.substr(metric_opt.size());
+      if (m == "l2") {
+        metric = metric_t::l2;
+      } else if (m == "ip") {
+        metric = metric_t::ip;
+      } else {
+        std::fprintf(stderr, "[gt] Invalid metric %s\n", m.c_str());
+        return 1;
+      }
+    } else if (arg.compare(0, threads_opt.size(), threads_opt) == 0) {
+      num_threads = std::stoul(arg.substr(threads_opt.size()));
+    } else if (arg.compare(0, batch_opt.size(), batch_opt) == 0) {
+      batch_size = std::max(1lu, std::stoul(arg.substr(batch_opt.size())));
+    } else if (arg.compare(0, distance_opt.size(), distance_opt) == 0) {
+      distance_path = arg.substr(distance_opt.size());
+    } else if (arg == "--bigann") {
+      bigann = true;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 5) {
+    std::fprintf(stderr,
+                 "Usage: %s [--metric=l2|ip] [--threads=N] [--batch-size=N] "
+                 "[--bigann | --distances=fvecs path] [dtype (int8, uint8, "
+                 "float)] [base path] [query path] [k] [output path]\n"
+                 "  Writes the ids as ivecs, or ids and distances as a BIGANN "
+                 "ground truth file with --bigann\n",
+                 argv[0]);
+    return 1;
+  }
+
+  const std::string dtype(args[0]);
+  const std::size_t k = std::stoul(args[3]);
+  if (k == 0) {
+    std::fprintf(stderr, "[gt] k must be greater than 0\n");
+    return 1;
+  }
+  if (dtype == "float") {
+    return gt_core<float>(args[1], args[2], k, args[4], distance_path, metric,
+                          bigann, num_threads, batch_size);
+  } else if (dtype == "int8") {
+    return gt_core<std::int8_t>(args[1], args[2], k, args[4], distance_path,
+                                metric, bigann, num_threads, batch_size);
+  } else if (dtype == "uint8") {
+    return gt_core<std::uint8_t>(args[1], args[2], k, args[4], distance_path,
+                                 metric, bigann, num_threads, batch_size);
+  }
+  std::fprintf(stderr, "[gt] Invalid data type %s\n", dtype.c_str());
+  return 1;
+}
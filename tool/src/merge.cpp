@@ -1,89 +1,295 @@
 #include <anns_dataset.hpp>
 #include <chrono>
+#include <limits>
 #include <vector>
 
-#define UNUSED(a)                                                              \
-  do {                                                                         \
-    (void)(a);                                                                 \
-  } while (0)
+namespace {
+// Copy `size` bytes between files in the kernel when possible
+void copy_file_data(const int in_fd, const std::size_t in_offset,
+                    const int out_fd, const std::size_t out_offset,
+                    const std::size_t size) {
+  std::size_t done = 0;
+  while (done < size) {
+    loff_t in_off = in_offset + done;
+    loff_t out_off = out_offset + done;
+    const auto res =
+        copy_file_range(in_fd, &in_off, out_fd, &out_off, size - done, 0);
+    if (res < 0 && errno == EINTR) {
+      continue;
+    }
+    if (res <= 0) {
+      break;
+    }
+    done += res;
+  }
+  if (done == size) {
+    return;
+  }
+
+  // Fall back to user space copy (e.g. across file systems)
+  std::vector<char> buffer(std::min<std::size_t>(size - done, 64lu << 20));
+  while (done < size) {
+    const auto s = std::min(buffer.size(), size - done);
+    mtk::anns_dataset::detail::pread_all(in_fd, buffer.data(), s,
+                                         in_offset + done);
+    mtk::anns_dataset::detail::pwrite_all(out_fd, buffer.data(), s,
+                                          out_offset + done);
+    done += s;
+  }
+}
+
+template <class T>
+int merge_concat(const std::string output_path,
+                 const std::vector<std::string> &input_path_list,
+                 const std::vector<mtk::anns_dataset::layout_t> &layout_list,
+                 const std::size_t total_dataset_size) {
+  const auto &layout_0 = layout_list[0];
+  const bool is_vecs = (layout_0.format &
+                        mtk::anns_dataset::format_t::FORMAT_VECS) !=
+                       mtk::anns_dataset::format_t::FORMAT_UNKNOWN;
+
+  const int out_fd =
+      ::open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out_fd < 0) {
+    std::fprintf(stderr, "[merge] Failed to open %s\n", output_path.c_str());
+    return 1;
+  }
+
+  std::size_t out_offset = 0;
+  int in_fd = -1;
+  try {
+    if (!is_vecs) {
+      if (layout_0.data_offset == 2 * sizeof(std::uint64_t)) {
+        const std::uint64_t header[2] = {total_dataset_size,
+                                         layout_0.data_dim};
+        mtk::anns_dataset::detail::pwrite_all(out_fd, header, sizeof(header),
+                                              0);
+      } else {
+        const std::uint32_t header[2] = {
+            static_cast<std::uint32_t>(total_dataset_size),
+            static_cast<std::uint32_t>(layout_0.data_dim)};
+        mtk::anns_dataset::detail::pwrite_all(out_fd, header, sizeof(header),
+                                              0);
+      }
+      out_offset = layout_0.data_offset;
+    }
+
+    for (std::size_t i = 0; i < input_path_list.size(); i++) {
+      const auto start_clock = std::chrono::system_clock::now();
+      const auto &layout = layout_list[i];
+      std::printf("[merge] Merging %s [size=%lu] (%3lu / %3lu) ...",
+                  input_path_list[i].c_str(), layout.num_data, i + 1,
+                  input_path_list.size());
+      std::fflush(stdout);
+
+      in_fd = ::open(input_path_list[i].c_str(), O_RDONLY);
+      if (in_fd < 0) {
+        throw std::runtime_error("Failed to open " + input_path_list[i]);
+      }
+      // VECS files are concatenated as they are
+      const std::size_t in_offset = is_vecs ? 0 : layout.data_offset;
+      const std::size_t size = layout.num_data * layout.row_stride;
+      copy_file_data(in_fd, in_offset, out_fd, out_offset, size);
+      out_offset += size;
+      ::close(in_fd);
+      in_fd = -1;
+
+      const auto end_clock = std::chrono::system_clock::now();
+      const auto elapsed_time =
+          std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
+                                                                start_clock)
+              .count() *
+          1e-6;
+      std::printf(" Done [%.3fs]\n", elapsed_time);
+    }
+  } catch (const std::exception &e) {
+    std::printf("\n");
+    std::fflush(stdout);
+    std::fprintf(stderr, "[merge] %s (%s)\n", e.what(), output_path.c_str());
+    if (in_fd >= 0) {
+      ::close(in_fd);
+    }
+    ::close(out_fd);
+    return 1;
+  }
+
+  std::printf("[merge] Total dataset size : %lu\n", total_dataset_size);
+  std::printf("[merge] Closing %s\n", output_path.c_str());
+  ::close(out_fd);
+  return 0;
+}
+
+template <class T>
+int merge_stream(const std::string output_path,
+                 const std::vector<std::string> &input_path_list,
+                 const std::vector<mtk::anns_dataset::layout_t> &layout_list,
+                 const std::size_t total_dataset_size,
+                 const std::size_t memory_budget) {
+  const auto &layout_0 = layout_list[0];
+  const auto row_bytes = layout_0.data_dim * sizeof(T);
+
+  // Two prefetch buffers, a staging buffer and the store_stream buffer
+  const auto store_buffer_size = memory_budget / 4;
+  const auto batch_size = std::max<std::size_t>(
+      1, memory_budget / 4 / std::max<std::size_t>(1, row_bytes));
+
+  try {
+    mtk::anns_dataset::store_stream<T> ss(output_path, layout_0.data_dim,
+                                          layout_0.format, false,
+                                          store_buffer_size);
+
+    for (std::size_t i = 0; i < input_path_list.size(); i++) {
+      const auto start_clock = std::chrono::system_clock::now();
+      const auto &layout = layout_list[i];
+      std::printf("[merge] Merging %s [size=%lu] (%3lu / %3lu) ...",
+                  input_path_list[i].c_str(), layout.num_data, i + 1,
+                  input_path_list.size());
+      std::fflush(stdout);
+
+      mtk::anns_dataset::load_stream<T> ls(input_path_list[i], batch_size,
+                                           layout.format);
+      for (const auto &batch : ls) {
+        ss.append(batch.data, layout.data_dim, batch.size);
+      }
+
+      const auto end_clock = std::chrono::system_clock::now();
+      const auto elapsed_time =
+          std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
+                                                                start_clock)
+              .count() *
+          1e-6;
+      std::printf(" Done [%.3fs]\n", elapsed_time);
+    }
+
+    std::printf("[merge] Total dataset size : %lu\n", total_dataset_size);
+    std::printf("[merge] Closing %s\n", output_path.c_str());
+    ss.close();
+  } catch (const std::exception &e) {
+    std::printf("\n");
+    std::fflush(stdout);
+    std::fprintf(stderr, "[merge] %s (%s)\n", e.what(), output_path.c_str());
+    return 1;
+  }
+
+  return 0;
+}
+} // unnamed namespace
 
 template <class T>
 int merge_core(const std::string output_path,
-               const std::vector<std::string> input_path_list) {
-  const auto [dataset_size_0, dataset_dim_0] =
-      mtk::anns_dataset::load_size_info<T>(input_path_list[0]);
-  const auto format =
-      mtk::anns_dataset::detect_file_format<T>(input_path_list[0]);
-  UNUSED(dataset_size_0);
-
-  mtk::anns_dataset::store_stream<T> ss(output_path, dataset_dim_0, format);
-  std::printf("[merge] Output path : %s\n", output_path.c_str());
+               const std::vector<std::string> input_path_list,
+               const std::size_t memory_budget, const unsigned num_threads) {
+  // Validate all input headers before moving any data
+  const auto num_inputs = input_path_list.size();
+  std::vector<mtk::anns_dataset::layout_t> layout_list(num_inputs);
+  std::vector<std::string> error_list(num_inputs);
+  mtk::anns_dataset::detail::parallel_for_chunks(
+      num_inputs, 1, num_threads,
+      [&](const std::size_t i, const std::size_t) {
+        try {
+          layout_list[i] =
+              mtk::anns_dataset::load_layout<T>(input_path_list[i]);
+        } catch (const std::exception &e) {
+          error_list[i] = e.what();
+        }
+      });
+  for (std::size_t i = 0; i < num_inputs; i++) {
+    if (!error_list[i].empty()) {
+      std::fprintf(stderr, "[merge] Invalid input %s (%s)\n",
+                   input_path_list[i].c_str(), error_list[i].c_str());
+      return 1;
+    }
+  }
 
+  const auto &layout_0 = layout_list[0];
   std::size_t total_dataset_size = 0;
-  std::uint32_t num_processed = 0;
-  for (const auto &input_path : input_path_list) {
-    const auto start_clock = std::chrono::system_clock::now();
-    const auto [dataset_size, dataset_dim] =
-        mtk::anns_dataset::load_size_info<T>(input_path_list[0]);
-    std::printf("[merge] Merging %s [size=%lu] (%3u / %3lu) ...",
-                input_path.c_str(), dataset_size, num_processed + 1,
-                input_path_list.size());
-
-    if (dataset_dim != dataset_dim_0) {
-      std::printf("\n");
+  bool same_format = true;
+  for (std::size_t i = 0; i < layout_list.size(); i++) {
+    const auto &layout = layout_list[i];
+    if (layout.data_dim != layout_0.data_dim) {
       std::fprintf(stderr,
                    "[merge] Inconsistent dataset dim. [%s].dim = %lu v.s. "
                    "[%s].dim = %lu\n",
-                   input_path_list[0].c_str(), dataset_dim_0,
-                   input_path.c_str(), dataset_dim);
+                   input_path_list[0].c_str(), layout_0.data_dim,
+                   input_path_list[i].c_str(), layout.data_dim);
       return 1;
     }
+    same_format = same_format && (layout.format == layout_0.format);
+    total_dataset_size += layout.num_data;
+  }
 
-    std::vector<T> dataset_buffer(dataset_dim * dataset_size);
-    mtk::anns_dataset::load(dataset_buffer.data(), input_path);
-
-    ss.append(dataset_buffer.data(), dataset_dim, dataset_size);
-
-    const auto end_clock = std::chrono::system_clock::now();
-    const auto elapsed_time =
-        std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
-                                                              start_clock)
-            .count() *
-        1e-6;
-    std::printf(" Done [%.3fs]\n", elapsed_time);
-    num_processed++;
-    total_dataset_size += dataset_size;
+  // The number of vectors in a BIGANN header must fit the header type
+  const bool u32_bigann =
+      (layout_0.format & mtk::anns_dataset::format_t::FORMAT_MASK) ==
+          mtk::anns_dataset::format_t::FORMAT_BIGANN &&
+      layout_0.data_offset != 2 * sizeof(std::uint64_t);
+  if (u32_bigann &&
+      total_dataset_size > std::numeric_limits<std::uint32_t>::max()) {
+    std::fprintf(stderr,
+                 "[merge] Total dataset size %lu does not fit the 32-bit "
+                 "BIGANN header of %s\n",
+                 total_dataset_size, input_path_list[0].c_str());
+    return 1;
   }
 
-  std::printf("[merge] Total dataset size : %lu\n", total_dataset_size);
-  std::printf("[merge] Closing %s\n", output_path.c_str());
-  ss.close();
+  std::printf("[merge] Output path : %s\n", output_path.c_str());
+  std::printf("[merge] Output format : %s\n",
+              mtk::anns_dataset::get_format_str(layout_0.format).c_str());
 
-  return 0;
+  if (same_format) {
+    return merge_concat<T>(output_path, input_path_list, layout_list,
+                           total_dataset_size);
+  }
+  return merge_stream<T>(output_path, input_path_list, layout_list,
+                         total_dataset_size, memory_budget);
 }
 
 int main(int argc, char **argv) {
-  if (argc <= 3) {
+  // Default memory budget: 1 GiB
+  std::size_t memory_budget = 1lu << 30;
+  unsigned num_threads = 0;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::string budget_opt = "--memory-budget=";
+    const std::string threads_opt = "--threads=";
+    if (arg.compare(0, budget_opt.size(), budget_opt) == 0) {
+      memory_budget = std::stoul(arg.substr(budget_opt.size())) << 20;
+    } else if (arg.compare(0, threads_opt.size(), threads_opt) == 0) {
+      num_threads = std::stoul(arg.substr(threads_opt.size()));
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() <= 2) {
     std::fprintf(stderr,
-                 "Usage: %s [dtype (int8, uint8, float)] [output_path] "
+                 "Usage: %s [--memory-budget=MiB] [--threads=N] [dtype "
+                 "(int8, uint8, float, float16, bfloat16)] [output_path] "
                  "[input_path 0] [input_path 1] ...\n",
                  argv[0]);
     return 1;
   }
 
-  const std::string dtype(argv[1]);
-  const std::string output_path(argv[2]);
-  std::vector<std::string> input_path_list;
-  for (std::uint32_t i = 3; i < static_cast<std::uint32_t>(argc); i++) {
-    input_path_list.push_back(std::string(argv[i]));
-  }
+  const std::string dtype(args[0]);
+  const std::string output_path(args[1]);
+  std::vector<std::string> input_path_list(args.begin() + 2, args.end());
 
   if (dtype == "float") {
-    return merge_core<float>(output_path, input_path_list);
+    return merge_core<float>(output_path, input_path_list, memory_budget,
+                             num_threads);
   } else if (dtype == "int8") {
-    return merge_core<std::int8_t>(output_path, input_path_list);
+    return merge_core<std::int8_t>(output_path, input_path_list,
+                                   memory_budget, num_threads);
   } else if (dtype == "uint8") {
-    return merge_core<std::uint8_t>(output_path, input_path_list);
+    return merge_core<std::uint8_t>(output_path, input_path_list,
+                                    memory_budget, num_threads);
+  } else if (dtype == "float16") {
+    return merge_core<mtk::anns_dataset::float16_t>(
+        output_path, input_path_list, memory_budget, num_threads);
+  } else if (dtype == "bfloat16") {
+    return merge_core<mtk::anns_dataset::bfloat16_t>(
+        output_path, input_path_list, memory_budget, num_threads);
   } else {
     std::fprintf(stderr, "[merge] Invalid data type %s\n", dtype.c_str());
     return 1;
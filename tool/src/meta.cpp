@@ -0,0 +1,90 @@
+#include <anns_dataset.hpp>
+#include <vector>
+
+namespace {
+template <class T> int meta_create(const std::string path) {
+  try {
+    mtk::anns_dataset::store_metadata<T>(path);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[meta] Failed to create metadata of %s (%s)\n",
+                 path.c_str(), e.what());
+    return 1;
+  }
+  std::printf("[meta] Created %s\n",
+              mtk::anns_dataset::get_metadata_path(path).c_str());
+  return 0;
+}
+
+int meta_verify(const std::string path) {
+  mtk::anns_dataset::metadata_t metadata;
+  if (!mtk::anns_dataset::load_metadata(path, metadata, true)) {
+    std::printf("[meta] %s : INVALID\n", path.c_str());
+    return 1;
+  }
+  std::printf("[meta] %s : OK\n", path.c_str());
+  return 0;
+}
+
+int meta_show(const std::string path) {
+  mtk::anns_dataset::metadata_t metadata;
+  const auto valid = mtk::anns_dataset::load_metadata(path, metadata);
+  std::printf("[meta] %s%s\n", path.c_str(), valid ? "" : " (INVALID)");
+  std::printf("[meta]   format       : %s\n",
+              mtk::anns_dataset::get_format_str(metadata.layout.format)
+                  .c_str());
+  std::printf("[meta]   element type : %s (%zu bytes)\n",
+              metadata.element_type.c_str(), metadata.element_size);
+  std::printf("[meta]   num data     : %zu\n", metadata.layout.num_data);
+  std::printf("[meta]   data dim     : %zu\n", metadata.layout.data_dim);
+  std::printf("[meta]   data offset  : %zu\n", metadata.layout.data_offset);
+  std::printf("[meta]   row stride   : %zu\n", metadata.layout.row_stride);
+  std::printf("[meta]   file size    : %zu\n", metadata.layout.file_size);
+  return valid ? 0 : 1;
+}
+} // unnamed namespace
+
+int main(int argc, char **argv) {
+  if (argc <= 2) {
+    std::fprintf(stderr,
+                 "Usage: %s create [dtype (int8, uint8, float, float16, "
+                 "bfloat16)] [path 0] [path 1] ...\n"
+                 "       %s verify [path 0] [path 1] ...\n"
+                 "       %s show [path 0] [path 1] ...\n",
+                 argv[0], argv[0], argv[0]);
+    return 1;
+  }
+
+  const std::string mode(argv[1]);
+  int res = 0;
+  if (mode == "create") {
+    const std::string dtype(argv[2]);
+    for (int i = 3; i < argc; i++) {
+      if (dtype == "float") {
+        res |= meta_create<float>(argv[i]);
+      } else if (dtype == "int8") {
+        res |= meta_create<std::int8_t>(argv[i]);
+      } else if (dtype == "uint8") {
+        res |= meta_create<std::uint8_t>(argv[i]);
+      } else if (dtype == "float16") {
+        res |= meta_create<mtk::anns_dataset::float16_t>(argv[i]);
+      } else if (dtype == "bfloat16") {
+        res |= meta_create<mtk::anns_dataset::bfloat16_t>(argv[i]);
+      } else {
+        std::fprintf(stderr, "[meta] Invalid data type %s\n", dtype.c_str());
+        return 1;
+      }
+    }
+  } else if (mode == "verify") {
+    for (int i = 2; i < argc; i++) {
+      res |= meta_verify(argv[i]);
+    }
+  } else if (mode == "show") {
+    for (int i = 2; i < argc; i++) {
+      res |= meta_show(argv[i]);
+    }
+  } else {
+    std::fprintf(stderr, "[meta] Invalid mode %s\n", mode.c_str());
+    return 1;
+  }
+  return res;
+}
@@ -0,0 +1,73 @@
+#include <anns_dataset.hpp>
+#include <chrono>
+#include <vector>
+
+template <class Q>
+int sq8_core(const std::string input_path, const std::string output_path,
+             const double clip_quantile, const unsigned num_threads) {
+  mtk::anns_dataset::layout_t layout;
+  try {
+    layout = mtk::anns_dataset::load_layout<float>(input_path);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[sq8] Invalid input %s (%s)\n", input_path.c_str(),
+                 e.what());
+    return 1;
+  }
+  std::printf("[sq8] Input  : %s [%s, size=%lu, dim=%lu]\n",
+              input_path.c_str(),
+              mtk::anns_dataset::get_format_str(layout.format).c_str(),
+              layout.num_data, layout.data_dim);
+  std::printf("[sq8] Output : %s (%s)\n", output_path.c_str(),
+              mtk::anns_dataset::get_sq_params_path(output_path).c_str());
+
+  const auto start_clock = std::chrono::system_clock::now();
+  const auto res = mtk::anns_dataset::quantize_sq8<Q>(
+      input_path, output_path, layout.format, clip_quantile, num_threads,
+      1lu << 16, true);
+  const auto end_clock = std::chrono::system_clock::now();
+  const auto elapsed_time =
+      std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
+                                                            start_clock)
+          .count() *
+      1e-6;
+  std::printf("[sq8] Done [%.3fs]\n", elapsed_time);
+  return res;
+}
+
+int main(int argc, char **argv) {
+  double clip_quantile = 0;
+  unsigned num_threads = 0;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::string clip_opt = "--clip=";
+    const std::string threads_opt = "--threads=";
+    if (arg.compare(0, clip_opt.size(), clip_opt) == 0) {
+      clip_quantile = std::stod(arg.substr(clip_opt.size()));
+    } else if (arg.compare(0, threads_opt.size(), threads_opt) == 0) {
+      num_threads = std::stoul(arg.substr(threads_opt.size()));
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 3) {
+    std::fprintf(stderr,
+                 "Usage: %s [--clip=quantile (e.g. 0.001)] [--threads=N] "
+                 "[dtype (int8, uint8)] [input float dataset path] "
+                 "[output path]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  const std::string dtype(args[0]);
+  if (dtype == "int8") {
+    return sq8_core<std::int8_t>(args[1], args[2], clip_quantile,
+                                 num_threads);
+  } else if (dtype == "uint8") {
+    return sq8_core<std::uint8_t>(args[1], args[2], clip_quantile,
+                                  num_threads);
+  }
+  std::fprintf(stderr, "[sq8] Invalid data type %s\n", dtype.c_str());
+  return 1;
+}
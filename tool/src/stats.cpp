@@ -0,0 +1,90 @@
+#include <anns_dataset.hpp>
+#include <statistic.hpp>
+#include <vector>
+
+template <class T>
+int stats_core(const std::string path, const double sampling_rate,
+               const unsigned num_threads, const std::uint32_t graph_width,
+               const bool print_quantiles) {
+  try {
+    const auto stats = mtk::anns_dataset::compute_dimensionwise_stats<T>(
+        path, sampling_rate, num_threads, 1lu << 16, true);
+    if (graph_width) {
+      // The histograms need the range of each dimension
+      const auto histogram =
+          mtk::anns_dataset::compute_dimensionwise_histogram<T>(
+              path, graph_width, stats, sampling_rate, num_threads, 1lu << 16,
+              true);
+      mtk::anns_dataset::print_dimensionwise_distribution(stats, histogram,
+                                                          graph_width);
+    } else {
+      mtk::anns_dataset::print_dimensionwise_distribution(stats);
+    }
+
+    if (print_quantiles) {
+      const auto sketches =
+          mtk::anns_dataset::compute_dimensionwise_quantile_sketch<T>(
+              path, 200, sampling_rate, num_threads, 1lu << 16, true);
+      std::printf("%5s | %9s, %9s, %9s\n", "dim", "p1", "p50", "p99");
+      for (std::size_t j = 0; j < sketches.size(); j++) {
+        std::printf("%5lu | %+.2e, %+.2e, %+.2e\n", j,
+                    static_cast<double>(sketches[j].quantile(0.01)),
+                    static_cast<double>(sketches[j].quantile(0.5)),
+                    static_cast<double>(sketches[j].quantile(0.99)));
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[stats] Failed to process %s (%s)\n", path.c_str(),
+                 e.what());
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  double sampling_rate = 1;
+  unsigned num_threads = 0;
+  std::uint32_t graph_width = 0;
+  bool print_quantiles = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::string sampling_opt = "--sampling-rate=";
+    const std::string threads_opt = "--threads=";
+    const std::string graph_opt = "--graph-width=";
+    if (arg.compare(0, sampling_opt.size(), sampling_opt) == 0) {
+      sampling_rate = std::stod(arg.substr(sampling_opt.size()));
+    } else if (arg.compare(0, threads_opt.size(), threads_opt) == 0) {
+      num_threads = std::stoul(arg.substr(threads_opt.size()));
+    } else if (arg.compare(0, graph_opt.size(), graph_opt) == 0) {
+      graph_width = std::stoul(arg.substr(graph_opt.size()));
+    } else if (arg == "--quantiles") {
+      print_quantiles = true;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 2) {
+    std::fprintf(stderr,
+                 "Usage: %s [--sampling-rate=r (0, 1]] [--threads=N] "
+                 "[--graph-width=W] [--quantiles] [dtype (int8, uint8, float)] "
+                 "[dataset path]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  const std::string dtype(args[0]);
+  if (dtype == "float") {
+    return stats_core<float>(args[1], sampling_rate, num_threads, graph_width,
+                             print_quantiles);
+  } else if (dtype == "int8") {
+    return stats_core<std::int8_t>(args[1], sampling_rate, num_threads,
+                                   graph_width, print_quantiles);
+  } else if (dtype == "uint8") {
+    return stats_core<std::uint8_t>(args[1], sampling_rate, num_threads,
+                                    graph_width, print_quantiles);
+  }
+  std::fprintf(stderr, "[stats] Invalid data type %s\n", dtype.c_str());
+  return 1;
+}
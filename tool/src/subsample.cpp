@@ -0,0 +1,322 @@
+#include <anns_dataset.hpp>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+enum class sample_mode_t { random, first, stride };
+
+// Sequential random sampling of n out of N rows by Vitter's Algorithm D
+// ("An efficient algorithm for sequential random sampling", ACM TOMS 1987).
+// Each call of skip() returns the number of rows to skip before the next
+// selected row, so the expected cost is O(n) instead of O(N).
+class skip_sampler {
+  // Algorithm A is faster while alpha * n >= N
+  static constexpr double alpha = 13;
+
+  std::mt19937_64 mt;
+  std::uniform_real_distribution<double> dist;
+  // The numbers of rows to be selected / left
+  std::size_t n;
+  std::size_t N;
+  double v_prime = 0;
+  bool use_a = false;
+
+  // Uniform in (0, 1)
+  double uniform() {
+    double u;
+    do {
+      u = dist(mt);
+    } while (u == 0);
+    return u;
+  }
+
+  std::size_t skip_a() {
+    const auto v = uniform();
+    std::size_t s = 0;
+    double top = N - n;
+    double num_rows = N;
+    double quot = top / num_rows;
+    while (quot > v) {
+      s++;
+      top--;
+      num_rows--;
+      quot *= top / num_rows;
+    }
+    return s;
+  }
+
+  std::size_t skip_d() {
+    const double nd = n;
+    const double Nd = N;
+    const double n_min1_inv = 1. / (nd - 1);
+    const double qu1 = Nd - nd + 1;
+    double x;
+    std::size_t s;
+    while (true) {
+      // Step D2: draw X with s = floor(X) < N - n + 1
+      while (true) {
+        x = Nd * (1 - v_prime);
+        s = static_cast<std::size_t>(x);
+        if (s < qu1) {
+          break;
+        }
+        v_prime = std::exp(std::log(uniform()) / nd);
+      }
+      // Step D3: accept with the squeeze function. v_prime is reused for
+      // the next row when accepted.
+      const double y1 = std::exp(std::log(uniform() * Nd / qu1) * n_min1_inv);
+      v_prime = y1 * (1 - x / Nd) * (qu1 / (qu1 - s));
+      if (v_prime <= 1) {
+        break;
+      }
+      // Step D4: accept with the exact probability
+      double y2 = 1;
+      double top = Nd - 1;
+      double bottom, limit;
+      if (nd - 1 > s) {
+        bottom = Nd - nd;
+        limit = Nd - s;
+      } else {
+        bottom = Nd - s - 1;
+        limit = qu1;
+      }
+      for (double t = Nd - 1; t >= limit; t--) {
+        y2 *= top / bottom;
+        top--;
+        bottom--;
+      }
+      if (Nd / (Nd - x) >= y1 * std::exp(std::log(y2) * n_min1_inv)) {
+        v_prime = std::exp(std::log(uniform()) * n_min1_inv);
+        break;
+      }
+      v_prime = std::exp(std::log(uniform()) / nd);
+    }
+    return s;
+  }
+
+public:
+  skip_sampler(const std::size_t n, const std::size_t N,
+               const std::uint64_t seed)
+      : mt(seed), dist(0, 1), n(n), N(N) {
+    if (n != 0) {
+      v_prime = std::exp(std::log(uniform()) / n);
+    }
+  }
+
+  // The number of rows to skip before the next selected row (n > 0)
+  std::size_t skip() {
+    std::size_t s;
+    if (n == 1) {
+      s = std::min(N - 1, static_cast<std::size_t>(N * uniform()));
+    } else {
+      use_a = use_a || alpha * n >= N;
+      s = use_a ? skip_a() : skip_d();
+    }
+    N -= s + 1;
+    n--;
+    return s;
+  }
+};
+
+// Generates the selected row ids in increasing order without storing the ids
+// that have not been emitted yet
+class id_generator {
+  const sample_mode_t mode;
+  const std::size_t num_select;
+  const std::size_t stride;
+  skip_sampler sampler;
+  std::size_t next_row = 0;
+  std::size_t num_selected = 0;
+
+public:
+  id_generator(const sample_mode_t mode, const std::size_t num_data,
+               const std::size_t num_select, const std::size_t stride,
+               const std::uint64_t seed)
+      : mode(mode), num_select(num_select), stride(stride),
+        sampler(num_select, num_data, seed) {}
+
+  // Append up to `max_ids` ids to `ids`. Returns false when exhausted.
+  bool next(std::vector<std::uint64_t> &ids, const std::size_t max_ids) {
+    ids.clear();
+    while (ids.size() < max_ids && num_selected < num_select) {
+      auto row = next_row;
+      if (mode == sample_mode_t::random) {
+        row += sampler.skip();
+      } else if (mode == sample_mode_t::stride) {
+        row = num_selected * stride;
+      }
+      ids.push_back(row);
+      next_row = row + 1;
+      num_selected++;
+    }
+    return !ids.empty();
+  }
+};
+
+template <class T>
+int subsample_core(const std::string input_path, const std::string output_path,
+                   const std::string id_path, const sample_mode_t mode,
+                   std::size_t num_select, const std::size_t stride,
+                   const std::uint64_t seed, const unsigned num_threads,
+                   const std::size_t batch_size) {
+  std::unique_ptr<mtk::anns_dataset::dataset_file<T>> file;
+  try {
+    file = std::make_unique<mtk::anns_dataset::dataset_file<T>>(input_path);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "[subsample] Invalid input %s (%s)\n",
+                 input_path.c_str(), e.what());
+    return 1;
+  }
+  const auto num_data = file->size();
+  const auto dim = file->dim();
+  if (mode == sample_mode_t::stride) {
+    num_select = (num_data + stride - 1) / stride;
+  }
+  num_select = std::min(num_select, num_data);
+
+  std::printf("[subsample] Input  : %s [%s, size=%zu, dim=%zu]\n",
+              input_path.c_str(),
+              mtk::anns_dataset::get_format_str(file->format()).c_str(),
+              num_data, dim);
+  std::printf("[subsample] Output : %s [size=%zu]\n", output_path.c_str(),
+              num_select);
+
+  const auto start_clock = std::chrono::system_clock::now();
+  try {
+    mtk::anns_dataset::store_stream<T> ss(output_path, dim, file->format());
+    std::unique_ptr<mtk::anns_dataset::store_stream<std::uint32_t>> id_ss;
+    if (!id_path.empty()) {
+      if (num_data > std::numeric_limits<std::uint32_t>::max()) {
+        std::fprintf(stderr, "[subsample] Too many vectors for 32-bit ids\n");
+        return 1;
+      }
+      // BIGANN file of (num_select x 1) ids
+      id_ss = std::make_unique<mtk::anns_dataset::store_stream<std::uint32_t>>(
+          id_path, 1, mtk::anns_dataset::format_t::FORMAT_BIGANN);
+    }
+
+    id_generator generator(mode, num_data, num_select, stride, seed);
+    std::vector<std::uint64_t> ids;
+    std::vector<std::uint32_t> ids_u32;
+    std::vector<T> buffer(std::min(batch_size, num_select) * dim);
+    while (generator.next(ids, batch_size)) {
+      // The ids are sorted, so the reads are positional and coalesced
+      if (file->load_rows(buffer.data(), ids.data(), ids.size(), num_threads)) {
+        return 1;
+      }
+      ss.append(buffer.data(), dim, ids.size());
+      if (id_ss) {
+        ids_u32.assign(ids.begin(), ids.end());
+        id_ss->append(ids_u32.data(), 1, ids_u32.size());
+      }
+      std::printf("[subsample] Extracting... (%4.2f %%)\r",
+                  ss.size() * 100. / num_select);
+      std::fflush(stdout);
+    }
+    std::printf("\n");
+    ss.close();
+    if (id_ss) {
+      id_ss->close();
+      std::printf("[subsample] Ids    : %s\n", id_path.c_str());
+    }
+  } catch (const std::exception &e) {
+    std::printf("\n");
+    std::fflush(stdout);
+    std::fprintf(stderr, "[subsample] %s (%s)\n", e.what(),
+                 output_path.c_str());
+    return 1;
+  }
+
+  const auto end_clock = std::chrono::system_clock::now();
+  const auto elapsed_time =
+      std::chrono::duration_cast<std::chrono::microseconds>(end_clock -
+                                                            start_clock)
+          .count() *
+      1e-6;
+  std::printf("[subsample] Done [%.3fs]\n", elapsed_time);
+  return 0;
+}
+} // unnamed namespace
+
+int main(int argc, char **argv) {
+  sample_mode_t mode = sample_mode_t::random;
+  std::size_t num_select = 0;
+  std::size_t stride = 1;
+  std::uint64_t seed = 0;
+  unsigned num_threads = 0;
+  std::size_t batch_size = 1lu << 20;
+  std::string id_path;
+  bool mode_given = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::string random_opt = "--random=";
+    const std::string first_opt = "--first=";
+    const std::string stride_opt = "--stride=";
+    const std::string seed_opt = "--seed=";
+    const std::string threads_opt = "--threads=";
+    const std::string batch_opt = "--batch-size=";
+    const std::string ids_opt = "--ids=";
+    if (arg.compare(0, random_opt.size(), random_opt) == 0) {
+      mode = sample_mode_t::random;
+      num_select = std::stoul(arg.substr(random_opt.size()));
+      mode_given = true;
+    } else if (arg.compare(0, first_opt.size(), first_opt) == 0) {
+      mode = sample_mode_t::first;
+      num_select = std::stoul(arg.substr(first_opt.size()));
+      mode_given = true;
+    } else if (arg.compare(0, stride_opt.size(), stride_opt) == 0) {
+      mode = sample_mode_t::stride;
+      stride = std::max(1lu, std::stoul(arg.substr(stride_opt.size())));
+      mode_given = true;
+    } else if (arg.compare(0, seed_opt.size(), seed_opt) == 0) {
+      seed = std::stoull(arg.substr(seed_opt.size()));
+    } else if (arg.compare(0, threads_opt.size(), threads_opt) == 0) {
+      num_threads = std::stoul(arg.substr(threads_opt.size()));
+    } else if (arg.compare(0, batch_opt.size(), batch_opt) == 0) {
+      batch_size = std::max(1lu, std::stoul(arg.substr(batch_opt.size())));
+    } else if (arg.compare(0, ids_opt.size(), ids_opt) == 0) {
+      id_path = arg.substr(ids_opt.size());
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 3 || !mode_given) {
+    std::fprintf(stderr,
+                 "Usage: %s [--random=N [--seed=S] | --first=N | --stride=K] "
+                 "[--ids=output id path] [--threads=N] [--batch-size=N] "
+                 "[dtype (int8, uint8, float, float16, bfloat16)] "
+                 "[input path] [output path]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  const std::string dtype(args[0]);
+  if (dtype == "float") {
+    return subsample_core<float>(args[1], args[2], id_path, mode, num_select,
+                                 stride, seed, num_threads, batch_size);
+  } else if (dtype == "int8") {
+    return subsample_core<std::int8_t>(args[1], args[2], id_path, mode,
+                                       num_select, stride, seed, num_threads,
+                                       batch_size);
+  } else if (dtype == "uint8") {
+    return subsample_core<std::uint8_t>(args[1], args[2], id_path, mode,
+                                        num_select, stride, seed, num_threads,
+                                        batch_size);
+  } else if (dtype == "float16") {
+    return subsample_core<mtk::anns_dataset::float16_t>(
+        args[1], args[2], id_path, mode, num_select, stride, seed, num_threads,
+        batch_size);
+  } else if (dtype == "bfloat16") {
+    return subsample_core<mtk::anns_dataset::bfloat16_t>(
+        args[1], args[2], id_path, mode, num_select, stride, seed, num_threads,
+        batch_size);
+  }
+  std::fprintf(stderr, "[subsample] Invalid data type %s\n", dtype.c_str());
+  return 1;
+}